@@ -0,0 +1,286 @@
+#include "broma-merger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <array>
+#include <format>
+#include <iostream>
+#include <unordered_set>
+
+#include "pattern-importer.hpp"
+
+static bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '~';
+}
+
+static std::string_view trim(std::string_view str) {
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.front()))) str.remove_prefix(1);
+    while (!str.empty() && std::isspace(static_cast<unsigned char>(str.back()))) str.remove_suffix(1);
+    return str;
+}
+
+/// Collapses whitespace runs, so "int  const &" and "int const &" compare equal
+static std::string normalize(std::string_view str) {
+    std::string result;
+    for (char c : trim(str)) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (!result.empty() && result.back() != ' ')
+                result += ' ';
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+/// Keywords that can end a type, so they are never taken for the argument name ("unsigned int", "long long")
+static bool isTypeKeyword(std::string_view word) {
+    static constexpr std::array<std::string_view, 16> keywords = {
+        "void", "bool", "char", "wchar_t", "char8_t", "char16_t", "char32_t", "short",
+        "int", "long", "float", "double", "signed", "unsigned", "const", "volatile"
+    };
+    return std::find(keywords.begin(), keywords.end(), word) != keywords.end();
+}
+
+/// Splits on commas that aren't nested inside <>, (), [] or {}
+static std::vector<std::string_view> splitArgs(std::string_view args) {
+    std::vector<std::string_view> result;
+    int depth = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < args.size(); i++) {
+        char c = args[i];
+        if (c == '<' || c == '(' || c == '[' || c == '{') depth++;
+        else if (c == '>' || c == ')' || c == ']' || c == '}') depth--;
+        else if (c == ',' && depth == 0) {
+            result.push_back(args.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    result.push_back(args.substr(start));
+    return result;
+}
+
+/// Strips the default value and the argument name, leaving the type
+static std::string getArgType(std::string_view arg) {
+    int depth = 0;
+    for (size_t i = 0; i < arg.size(); i++) {
+        char c = arg[i];
+        if (c == '<' || c == '(' || c == '[' || c == '{') depth++;
+        else if (c == '>' || c == ')' || c == ']' || c == '}') depth--;
+        else if (c == '=' && depth == 0) {
+            arg = arg.substr(0, i);
+            break;
+        }
+    }
+    arg = trim(arg);
+
+    // the name is the last identifier, if something that isn't part of it comes before
+    size_t nameStart = arg.size();
+    while (nameStart > 0 && isIdentifierChar(arg[nameStart - 1])) nameStart--;
+    if (nameStart > 0 && nameStart < arg.size() && !isTypeKeyword(arg.substr(nameStart))) {
+        char before = arg[nameStart - 1];
+        if (std::isspace(static_cast<unsigned char>(before)) || before == '*' || before == '&')
+            arg = arg.substr(0, nameStart);
+    }
+
+    return normalize(arg);
+}
+
+std::optional<BromaFunction> BromaFunction::parse(std::string_view line) {
+    auto trimmed = trim(line);
+    if (trimmed.starts_with("//"))
+        return std::nullopt;
+
+    auto open = line.find('(');
+    if (open == std::string_view::npos)
+        return std::nullopt;
+
+    auto before = trim(line.substr(0, open));
+    size_t nameStart = before.size();
+    while (nameStart > 0 && isIdentifierChar(before[nameStart - 1])) nameStart--;
+    if (nameStart == before.size())
+        return std::nullopt;
+
+    // find the matching parenthesis
+    int depth = 0;
+    size_t close = std::string_view::npos;
+    for (size_t i = open; i < line.size(); i++) {
+        if (line[i] == '(') depth++;
+        else if (line[i] == ')' && --depth == 0) {
+            close = i;
+            break;
+        }
+    }
+    if (close == std::string_view::npos)
+        return std::nullopt;
+
+    BromaFunction function;
+    function.name = before.substr(nameStart);
+    function.end = close + 1;
+
+    auto args = trim(line.substr(open + 1, close - open - 1));
+    if (!args.empty() && args != "void") {
+        for (auto arg : splitArgs(args))
+            function.args.push_back(getArgType(arg));
+    }
+
+    return function;
+}
+
+std::optional<std::string> BromaMerger::getClassName(std::string_view line) {
+    if (!line.starts_with("class "))
+        return std::nullopt;
+
+    auto name = trim(line.substr(6));
+    auto end = name.find_first_of(" :{");
+    return std::string(name.substr(0, end));
+}
+
+std::optional<uintptr_t> BromaMerger::getBinding(std::string_view line, std::string_view platform) {
+    auto needle = std::string(platform) + " 0x";
+    for (auto pos = line.find(needle); pos != std::string_view::npos; pos = line.find(needle, pos + 1)) {
+        // don't match the end of another platform name
+        if (pos > 0 && isIdentifierChar(line[pos - 1]))
+            continue;
+
+        try {
+            return std::stoull(std::string(line.substr(pos + needle.size())), nullptr, 16);
+        } catch (const std::exception&) {
+            return std::nullopt;
+        }
+    }
+    return std::nullopt;
+}
+
+std::unordered_map<uintptr_t, uintptr_t> BromaMerger::readFound(std::istream& found) {
+    std::unordered_map<uintptr_t, uintptr_t> result;
+
+    std::string line;
+    while (std::getline(found, line)) {
+        auto parts = PatternImporter::split(line, ',');
+        if (parts.size() != 3) continue;
+
+        try {
+            result[std::stoull(parts[0], nullptr, 16)] = std::stoull(parts[2], nullptr, 16);
+        } catch (const std::exception&) {
+            std::cerr << "Invalid line: " << line << std::endl;
+        }
+    }
+
+    return result;
+}
+
+void BromaMerger::loadOrigins(std::istream& oldBroma, std::string_view oldPlatform, const std::unordered_map<uintptr_t, uintptr_t>& found) {
+    std::string currentClass;
+    std::string line;
+    while (std::getline(oldBroma, line)) {
+        if (auto className = getClassName(line)) {
+            currentClass = *className;
+            continue;
+        }
+
+        if (currentClass.empty()) continue;
+
+        auto origin = getBinding(line, oldPlatform);
+        if (!origin) continue;
+
+        auto it = found.find(*origin);
+        if (it == found.end()) continue;
+
+        auto function = BromaFunction::parse(line);
+        if (!function) continue;
+
+        functions[currentClass + "::" + function->name].push_back({ std::move(function->args), it->second });
+        ++count;
+    }
+}
+
+BromaMerger::Stats BromaMerger::merge(std::istream& input, std::ostream& output) const {
+    Stats stats;
+    // entries that some line of the new broma was matched to, whether it was edited or not
+    std::unordered_set<const Entry*> matched;
+
+    std::string currentClass;
+    std::string line;
+    while (std::getline(input, line)) {
+        if (auto className = getClassName(line))
+            currentClass = *className;
+
+        auto function = currentClass.empty() ? std::nullopt : BromaFunction::parse(line);
+        auto it = function ? functions.find(currentClass + "::" + function->name) : functions.end();
+        if (it != functions.end()) {
+            // overloads are told apart by their argument types
+            auto entry = std::find_if(it->second.begin(), it->second.end(), [&](const Entry& e) {
+                return e.args == function->args;
+            });
+
+            if (entry != it->second.end()) {
+                matched.insert(&*entry);
+
+                // special fixes for inlined definitions
+                auto namePos = line.find(function->name + "(");
+                if (line.find(" new ") != std::string::npos) {
+                    std::cerr << "warning: tried to break inlined function (new): " << line << std::endl;
+                    ++stats.skipped;
+                } else if (auto equals = line.find('='); equals != std::string::npos && equals < namePos) {
+                    std::cerr << "warning: tried to break inlined function (equals): " << line << std::endl;
+                    ++stats.skipped;
+                } else if (line.find(" % ") != std::string::npos) {
+                    std::cerr << "warning: ignored line with %: " << line << std::endl;
+                    ++stats.skipped;
+                } else {
+                    line = addBinding(line, entry->address, stats);
+                }
+            }
+        }
+
+        output << line << '\n';
+    }
+
+    for (const auto& [name, entries] : functions) {
+        for (const auto& entry : entries) {
+            if (matched.contains(&entry)) continue;
+            std::cerr << std::format("warning: no function in the new broma matches {}(", name);
+            for (size_t i = 0; i < entry.args.size(); i++)
+                std::cerr << (i ? ", " : "") << entry.args[i];
+            std::cerr << std::format(") at 0x{:x}\n", entry.address);
+            ++stats.unmatched;
+        }
+    }
+
+    return stats;
+}
+
+std::string BromaMerger::addBinding(const std::string& line, uintptr_t address, Stats& stats) const {
+    // Several cases:
+    // 1. void func(); // No address
+    // 2. void func() = win 0x1234; // Already has address
+    // 3. void func() = mac 0x1234; // Has address but not this platform
+    // 4. void func() { } // Inlined function
+    // 5. void func() = mac 0x1234, win inline { } // Inlined function with address
+    if (auto existing = getBinding(line, platform)) {
+        if (*existing == address) ++stats.existed;
+        else ++stats.different;
+        return line;
+    }
+
+    auto function = BromaFunction::parse(line);
+    std::string_view bindings = std::string_view(line).substr(function->end);
+
+    // bindings go right before the body or the semicolon
+    auto terminator = bindings.find_first_of("{;");
+    if (terminator == std::string_view::npos) {
+        ++stats.skipped;
+        return line;
+    }
+
+    size_t insertAt = function->end + terminator;
+    while (insertAt > function->end && line[insertAt - 1] == ' ') insertAt--;
+
+    bool hasBindings = bindings.substr(0, terminator).find('=') != std::string_view::npos;
+    auto binding = std::format("{} {} 0x{:x}", hasBindings ? "," : " =", platform, address);
+
+    ++stats.added;
+    std::string result = line;
+    result.insert(insertAt, binding);
+    return result;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// Function declaration from a single broma line, e.g. `void foo(int a, cocos2d::CCPoint const& b) = win 0x1234;`
+struct BromaFunction {
+    std::string name;
+    /// argument types, with whitespace normalized
+    std::vector<std::string> args;
+    /// offset right after the closing parenthesis, where the bindings start
+    size_t end = 0;
+
+    [[nodiscard]] static std::optional<BromaFunction> parse(std::string_view line);
+};
+
+/// Replaces tests/reimport_bindings.py: copies a broma file and fills in addresses found by the importer.
+/// Functions are identified through the previous version's broma, where the original addresses are bound.
+class BromaMerger {
+public:
+    struct Stats {
+        /// already bound to the same address
+        size_t existed = 0;
+        /// already bound to another address (kept as is)
+        size_t different = 0;
+        /// address added
+        size_t added = 0;
+        /// skipped because the line looked unsafe to edit
+        size_t skipped = 0;
+        /// found in the old broma, but no function in the new one has the same name and arguments
+        size_t unmatched = 0;
+    };
+
+    explicit BromaMerger(std::string platform) : platform(std::move(platform)) {}
+
+    /// Maps original addresses (bound to `oldPlatform` in the old broma) to the functions they belong to.
+    /// `found` maps original addresses to new ones, as written by BindingsImporter
+    void loadOrigins(std::istream& oldBroma, std::string_view oldPlatform, const std::unordered_map<uintptr_t, uintptr_t>& found);
+
+    /// Streams `input` into `output`, adding the new addresses to matching functions
+    Stats merge(std::istream& input, std::ostream& output) const;
+
+    /// Reads "<original>,<name>,<new>" lines written by BindingsImporter
+    [[nodiscard]] static std::unordered_map<uintptr_t, uintptr_t> readFound(std::istream& found);
+
+    /// Returns the address bound to a platform on this line (`win 0x1234`)
+    [[nodiscard]] static std::optional<uintptr_t> getBinding(std::string_view line, std::string_view platform);
+
+    [[nodiscard]] size_t size() const { return count; }
+
+private:
+    struct Entry {
+        std::vector<std::string> args;
+        uintptr_t address;
+    };
+
+    /// Returns the class name if the line opens a class
+    [[nodiscard]] static std::optional<std::string> getClassName(std::string_view line);
+
+    [[nodiscard]] std::string addBinding(const std::string& line, uintptr_t address, Stats& stats) const;
+
+    std::string platform;
+    /// "Class::function" -> overloads with their new address
+    std::unordered_map<std::string, std::vector<Entry>> functions;
+    size_t count = 0;
+};
@@ -0,0 +1,80 @@
+#include "pattern-importer.hpp"
+#include "../scanner/reference.hpp"
+
+ImportResult PatternImporter::importLine(const Scanner& scanner, std::string_view line) {
+    ImportResult result;
+
+    auto parts = split(line, ',');
+    if (parts.size() != 3)
+        return result;
+
+    try {
+        result.offset = std::stoll(parts[0], nullptr, 16);
+    } catch (const std::exception&) {
+        return result;
+    }
+    result.name = parts[1];
+    const auto& pattern = parts[2];
+
+    auto results = std::vector<uintptr_t>();
+    bool found;
+    if (ReferenceSignature::isReference(pattern)) {
+        // find the referencing site and follow its operand to the function
+        auto reference = ReferenceSignature::fromString(pattern);
+        if (!reference)
+            return result;
+
+        std::vector<uintptr_t> sites;
+        found = scanner.find(reference->pattern, sites);
+        for (auto site : sites) {
+            if (auto target = reference->resolve(scanner, site))
+                results.push_back(*target);
+        }
+        found = found && !results.empty();
+    } else {
+        std::vector<PatternToken> tokens;
+        try {
+            tokens = PatternToken::fromString(pattern);
+        } catch (const std::exception&) {
+            return result;
+        }
+        found = scanner.find(tokens, results);
+    }
+
+    if (!found) {
+        result.status = ImportResult::Status::NotFound;
+        return result;
+    }
+
+    // filter out results that are too far away from original offset
+    auto offset = result.offset;
+    std::erase_if(results, [offset](uintptr_t match) {
+        if (match < offset)
+            return offset - match > maxDistance;
+        return match - offset > maxDistance;
+    });
+
+    if (results.empty()) {
+        result.status = ImportResult::Status::OutOfRange;
+    } else if (results.size() > 1) {
+        result.status = ImportResult::Status::Multiple;
+    } else {
+        result.status = ImportResult::Status::Found;
+        result.address = results[0];
+    }
+
+    return result;
+}
+
+std::vector<std::string> PatternImporter::split(std::string_view str, char separator) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    size_t end = str.find(separator);
+    while (end != std::string::npos) {
+        parts.emplace_back(str.substr(start, end - start));
+        start = end + 1;
+        end = str.find(separator, start);
+    }
+    parts.emplace_back(str.substr(start, end));
+    return parts;
+}
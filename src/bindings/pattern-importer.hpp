@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../scanner/scanner.hpp"
+
+/// Outcome of looking up one line of a patterns file in a newer binary
+struct ImportResult {
+    enum class Status {
+        Found,
+        NotFound,
+        /// more than one match close to the original offset
+        Multiple,
+        /// only matches too far away from the original offset
+        OutOfRange,
+        Invalid,
+    };
+
+    Status status = Status::Invalid;
+    /// offset in the original binary
+    uintptr_t offset = 0;
+    std::string name;
+    /// offset in the new binary
+    uintptr_t address = 0;
+};
+
+/// Finds mapper output ("<offset>,<name>,<pattern>") in a newer binary
+class PatternImporter {
+public:
+    /// Matches further than this from the original offset are ignored
+    static constexpr uintptr_t maxDistance = 0x50000;
+
+    [[nodiscard]] static ImportResult importLine(const Scanner& scanner, std::string_view line);
+
+    [[nodiscard]] static std::vector<std::string> split(std::string_view str, char separator);
+};
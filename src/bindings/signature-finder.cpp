@@ -0,0 +1,158 @@
+#include "signature-finder.hpp"
+
+/// Tracks the matches of a pattern that grows one opcode at a time
+class MatchTracker {
+public:
+    enum class State {
+        Unique,
+        Ambiguous,
+        NotFound,
+        /// the number of matches stopped going down
+        Stalled,
+        /// out of time or scans, or cancelled
+        OutOfBudget,
+    };
+
+    MatchTracker(const Scanner& scanner, SearchBudget& budget)
+        : scanner(scanner), options(budget.getOptions()), budget(budget) {}
+
+    State update(const std::vector<PatternToken>& pattern) {
+        CompiledPattern compiled(pattern);
+
+        // once there are few enough matches, only they have to be checked again
+        if (filtering) {
+            if (options.stopToken.stop_requested())
+                return State::OutOfBudget;
+            scanner.filter(compiled, matches);
+        } else {
+            if (!budget.spendScan())
+                return State::OutOfBudget;
+            matches.clear();
+            scanner.find(compiled, matches);
+            filtering = matches.size() <= maxFilteredMatches;
+        }
+
+        if (matches.empty())
+            return State::NotFound;
+        if (matches.size() == 1)
+            return State::Unique;
+
+        if (matches.size() < best) {
+            best = matches.size();
+            stalled = 0;
+        } else if (!filtering && options.maxStalledOpcodes > 0 && ++stalled >= options.maxStalledOpcodes) {
+            return State::Stalled;
+        }
+
+        return State::Ambiguous;
+    }
+
+private:
+    static constexpr size_t maxFilteredMatches = 0x1000;
+
+    const Scanner& scanner;
+    const SignatureOptions& options;
+    SearchBudget& budget;
+
+    std::vector<uintptr_t> matches;
+    bool filtering = false;
+    size_t best = SIZE_MAX;
+    size_t stalled = 0;
+};
+
+std::optional<FunctionSignature> findSignature(std::string_view name, uintptr_t address, size_t size, const Scanner& scanner, const Decompiler& decompiler, SearchBudget& budget) {
+    std::vector<Opcode> opcodes;
+    decompiler.decompile(address, size, opcodes);
+
+    MatchTracker tracker(scanner, budget);
+    std::vector<PatternToken> pattern;
+    for (const auto& opcode : opcodes) {
+        // add opcode to pattern and check if it matches any of the signatures
+        auto opcodePattern = opcode.getSafePattern();
+        pattern.insert(pattern.end(), opcodePattern.begin(), opcodePattern.end());
+
+        // check if only one result was found
+        auto state = tracker.update(pattern);
+        if (state == MatchTracker::State::Ambiguous)
+            continue;
+        if (state != MatchTracker::State::Unique)
+            return std::nullopt;
+
+        // construct the function signature
+        FunctionSignature signature;
+        signature.name = std::string(name);
+        signature.signature = PatternToken::fromPatternTokens(pattern);
+        return signature;
+    }
+
+    return std::nullopt;
+}
+
+std::optional<FunctionSignature> findXrefSignature(std::string_view name, uintptr_t address, const Scanner& scanner, const Decompiler& decompiler, const XrefIndex& xrefs, SearchBudget& budget) {
+    constexpr size_t maxCallerSize = 0x100;
+
+    for (const auto& xref : xrefs.getReferences(address)) {
+        std::vector<Opcode> opcodes;
+        decompiler.decompile(xref.address, maxCallerSize, opcodes);
+
+        ReferenceSignature signature;
+        signature.kind = xref.kind;
+        signature.operandOffset = xref.operandOffset;
+        signature.instructionLength = xref.instructionLength;
+
+        MatchTracker tracker(scanner, budget);
+        for (const auto& opcode : opcodes) {
+            auto opcodePattern = opcode.getSafePattern();
+
+            // the operand pointing at the function changes whenever it moves, so it can't be a part of the pattern
+            if (xref.kind == ReferenceKind::Rel32 && opcode.address == xref.address) {
+                for (size_t i = xref.operandOffset; i < xref.operandOffset + 4u && i < opcodePattern.size(); i++)
+                    opcodePattern[i] = PatternToken::wildcard();
+            } else if (xref.kind == ReferenceKind::Arm64AdrpAdd && opcode.address == xref.address + xref.operandOffset && opcodePattern.size() == 4) {
+                // ADD(imm) 0b11000000 0b00000000 0b00000000 0b11111111 without imm12 and registers
+                opcodePattern = {
+                    PatternToken::wildcard(),
+                    PatternToken::wildcard(),
+                    PatternToken::fromByteMask(opcode.bytes[2], 0b11000000),
+                    PatternToken::fromByte(opcode.bytes[3]),
+                };
+            }
+
+            signature.pattern.insert(signature.pattern.end(), opcodePattern.begin(), opcodePattern.end());
+
+            auto state = tracker.update(signature.pattern);
+            if (state == MatchTracker::State::Ambiguous)
+                continue;
+            if (state == MatchTracker::State::OutOfBudget)
+                return std::nullopt;
+            if (state != MatchTracker::State::Unique)
+                break;
+
+            FunctionSignature result;
+            result.name = std::string(name);
+            result.signature = signature.toString();
+            return result;
+        }
+    }
+
+    return std::nullopt;
+}
+
+uint64_t hashFunctionBody(const std::vector<Opcode>& opcodes) {
+    // FNV-1a over the masked bytes and masks, so only differences a pattern could see count
+    uint64_t hash = 0xCBF29CE484222325;
+    auto mix = [&hash](uint8_t byte) {
+        hash ^= byte;
+        hash *= 0x100000001B3;
+    };
+
+    for (const auto& opcode : opcodes) {
+        for (const auto& token : opcode.getSafePattern()) {
+            uint8_t mask = token.isWildcard ? 0 : token.mask;
+            mix(token.byte & mask);
+            mix(mask);
+        }
+    }
+
+    return hash;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+
+#include "../scanner/scanner.hpp"
+#include "../decompiler/decompiler.hpp"
+#include "../decompiler/xref-index.hpp"
+
+struct FunctionSignature {
+    std::string name;
+    std::string signature;
+};
+
+struct SignatureOptions {
+    /// Give up when this many opcodes in a row didn't reduce the number of matches (zero means no limit).
+    /// Thunks, identical template instantiations and such never become unique, but only opcodes that still
+    /// needed a full scan count, once few matches are left checking more opcodes is cheap
+    size_t maxStalledOpcodes = 32;
+
+    /// Give up on a function after this long (zero means no limit)
+    std::chrono::milliseconds timeBudget{0};
+    /// Give up on a function after this many full scans of the binary (zero means no limit).
+    /// Re-checking the few matches left once a pattern is almost unique doesn't count
+    size_t scanBudget = 0;
+
+    /// Cooperative cancellation, checked before every scan
+    std::stop_token stopToken;
+};
+
+/// Time and scan limits of the search for one function.
+/// The same budget is passed to every search made for a function, so a fallback search only gets what's left
+class SearchBudget {
+public:
+    explicit SearchBudget(const SignatureOptions& options)
+        : options(options), deadline(std::chrono::steady_clock::now() + options.timeBudget) {}
+
+    /// Counts a full scan, returns false if the search has to stop instead
+    bool spendScan() {
+        if (options.stopToken.stop_requested() ||
+            (options.timeBudget.count() > 0 && std::chrono::steady_clock::now() >= deadline) ||
+            (options.scanBudget > 0 && scans >= options.scanBudget)) {
+            exhausted = true;
+            return false;
+        }
+
+        ++scans;
+        return true;
+    }
+
+    /// True once a scan was refused (or the search was cancelled), any further search would give up right away
+    [[nodiscard]] bool isExhausted() const { return exhausted || options.stopToken.stop_requested(); }
+
+    [[nodiscard]] const SignatureOptions& getOptions() const { return options; }
+
+private:
+    const SignatureOptions& options;
+    std::chrono::steady_clock::time_point deadline;
+    size_t scans = 0;
+    bool exhausted = false;
+};
+
+/// Appends opcodes of the function to a pattern until it becomes unique
+std::optional<FunctionSignature> findSignature(std::string_view name, uintptr_t address, size_t size, const Scanner& scanner, const Decompiler& decompiler, SearchBudget& budget);
+
+/// Tries to find a unique pattern at one of the sites that reference the function
+std::optional<FunctionSignature> findXrefSignature(std::string_view name, uintptr_t address, const Scanner& scanner, const Decompiler& decompiler, const XrefIndex& xrefs, SearchBudget& budget);
+
+/// Hashes the safe pattern of a whole function. Functions with the same hash can't get a unique pattern from their own body
+[[nodiscard]] uint64_t hashFunctionBody(const std::vector<Opcode>& opcodes);
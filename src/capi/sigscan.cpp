@@ -0,0 +1,151 @@
+#include "sigscan.h"
+#include <cstring>
+
+#include "../scanner/scanner.hpp"
+#include "../decompiler/decompiler.hpp"
+#include "../bindings/signature-finder.hpp"
+
+struct sigscan_scanner {
+    Scanner scanner;
+
+    template <typename... Args>
+    explicit sigscan_scanner(Args&&... args) : scanner(std::forward<Args>(args)...) {}
+};
+
+struct sigscan_pattern {
+    std::vector<PatternToken> tokens;
+    CompiledPattern compiled;
+
+    explicit sigscan_pattern(std::vector<PatternToken> tokens)
+        : tokens(std::move(tokens)), compiled(this->tokens) {}
+};
+
+// nothing may throw across the C boundary, so every entry point catches everything
+
+sigscan_scanner* sigscan_scanner_open(const char* path, int64_t file_offset) {
+    try {
+        auto file = MappedFile::open(path);
+        if (!file) return nullptr;
+        return new sigscan_scanner(std::move(file), file_offset);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+sigscan_scanner* sigscan_scanner_from_buffer(const uint8_t* data, size_t size, int64_t file_offset) {
+    try {
+        return new sigscan_scanner(std::span<const uint8_t>(data, size), file_offset);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void sigscan_scanner_free(sigscan_scanner* scanner) {
+    delete scanner;
+}
+
+size_t sigscan_scanner_size(const sigscan_scanner* scanner) {
+    return scanner ? scanner->scanner.size() : 0;
+}
+
+void sigscan_scanner_set_alignment(sigscan_scanner* scanner, size_t alignment) {
+    if (scanner) scanner->scanner.setAlignment(alignment);
+}
+
+sigscan_pattern* sigscan_pattern_compile(const char* pattern) {
+    if (!pattern) return nullptr;
+    try {
+        auto tokens = PatternToken::fromString(pattern);
+        if (tokens.empty()) return nullptr;
+        return new sigscan_pattern(std::move(tokens));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void sigscan_pattern_free(sigscan_pattern* pattern) {
+    delete pattern;
+}
+
+size_t sigscan_pattern_size(const sigscan_pattern* pattern) {
+    return pattern ? pattern->tokens.size() : 0;
+}
+
+size_t sigscan_find(const sigscan_scanner* scanner, const sigscan_pattern* pattern, uint64_t* results, size_t capacity) {
+    if (!scanner || !pattern || pattern->tokens.empty()) return SIGSCAN_ERROR;
+    try {
+        std::vector<uintptr_t> matches;
+        scanner->scanner.find(pattern->compiled, matches);
+        for (size_t i = 0; i < matches.size() && i < capacity; i++)
+            results[i] = matches[i];
+        return matches.size();
+    } catch (...) {
+        return SIGSCAN_ERROR;
+    }
+}
+
+size_t sigscan_find_batch(
+    const sigscan_scanner* scanner, const sigscan_pattern* const* patterns, size_t pattern_count,
+    uint64_t* results, size_t capacity, size_t* counts
+) {
+    if (!scanner || !patterns) return SIGSCAN_ERROR;
+    // an empty pattern would match (and allocate a result for) every offset of the binary
+    for (size_t i = 0; i < pattern_count; i++) {
+        if (!patterns[i] || patterns[i]->tokens.empty())
+            return SIGSCAN_ERROR;
+    }
+
+    try {
+        std::vector<std::vector<PatternToken>> batch;
+        batch.reserve(pattern_count);
+        for (size_t i = 0; i < pattern_count; i++)
+            batch.push_back(patterns[i]->tokens);
+
+        std::vector<std::vector<uintptr_t>> matches;
+        scanner->scanner.findBatch(batch, matches);
+
+        size_t total = 0;
+        for (size_t i = 0; i < pattern_count; i++) {
+            if (counts) counts[i] = matches[i].size();
+            for (auto match : matches[i]) {
+                if (total < capacity)
+                    results[total] = match;
+                ++total;
+            }
+        }
+        return total;
+    } catch (...) {
+        return SIGSCAN_ERROR;
+    }
+}
+
+size_t sigscan_generate_signature(
+    sigscan_scanner* scanner, sigscan_arch arch, uint64_t address, size_t size,
+    char* buffer, size_t buffer_size
+) {
+    if (!scanner) return 0;
+    try {
+        Decompiler::Arch decompilerArch;
+        switch (arch) {
+            case SIGSCAN_ARCH_X86: decompilerArch = Decompiler::Arch::x86; break;
+            case SIGSCAN_ARCH_X86_64: decompilerArch = Decompiler::Arch::x86_64; break;
+            case SIGSCAN_ARCH_ARMV7: decompilerArch = Decompiler::Arch::armv7; break;
+            case SIGSCAN_ARCH_ARMV8: decompilerArch = Decompiler::Arch::armv8; break;
+            default: return 0;
+        }
+
+        Decompiler decompiler(scanner->scanner, decompilerArch);
+        SignatureOptions options;
+        SearchBudget budget(options);
+        auto signature = findSignature("", address, size, scanner->scanner, decompiler, budget);
+        if (!signature) return 0;
+
+        const auto& text = signature->signature;
+        if (buffer && buffer_size > text.size()) {
+            std::memcpy(buffer, text.c_str(), text.size() + 1);
+        }
+        return text.size();
+    } catch (...) {
+        return 0;
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+/// C interface of the sigscan library, for use from other languages (e.g. Python through ctypes).
+/// Every function is exception-safe and reports failures through its return value.
+/// Scanners and patterns are immutable after creation, so they can be shared between threads.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(SIGSCAN_SHARED)
+    #ifdef SIGSCAN_BUILDING
+        #define SIGSCAN_API __declspec(dllexport)
+    #else
+        #define SIGSCAN_API __declspec(dllimport)
+    #endif
+#elif defined(SIGSCAN_SHARED)
+    #define SIGSCAN_API __attribute__((visibility("default")))
+#else
+    #define SIGSCAN_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Returned by the functions that count matches when their arguments are invalid (or something failed)
+#define SIGSCAN_ERROR ((size_t)-1)
+
+typedef struct sigscan_scanner sigscan_scanner;
+typedef struct sigscan_pattern sigscan_pattern;
+
+typedef enum sigscan_arch {
+    SIGSCAN_ARCH_X86 = 0,
+    SIGSCAN_ARCH_X86_64 = 1,
+    SIGSCAN_ARCH_ARMV7 = 2,
+    SIGSCAN_ARCH_ARMV8 = 3,
+} sigscan_arch;
+
+/// Memory-maps a binary, returns NULL if it can't be opened
+SIGSCAN_API sigscan_scanner* sigscan_scanner_open(const char* path, int64_t file_offset);
+/// Scans a buffer owned by the caller without copying it, the buffer has to outlive the scanner.
+/// It also must not be modified while the scanner exists: an index of the buffer contents is built on
+/// the first scan and reused, so later writes lead to missed or stale matches.
+SIGSCAN_API sigscan_scanner* sigscan_scanner_from_buffer(const uint8_t* data, size_t size, int64_t file_offset);
+SIGSCAN_API void sigscan_scanner_free(sigscan_scanner* scanner);
+
+SIGSCAN_API size_t sigscan_scanner_size(const sigscan_scanner* scanner);
+/// Only match at offsets that are a multiple of `alignment` (4 for ARM64)
+SIGSCAN_API void sigscan_scanner_set_alignment(sigscan_scanner* scanner, size_t alignment);
+
+/// Parses a pattern string ("48 8B ? 8B&FC 4?"), returns NULL if it's malformed or empty
+SIGSCAN_API sigscan_pattern* sigscan_pattern_compile(const char* pattern);
+SIGSCAN_API void sigscan_pattern_free(sigscan_pattern* pattern);
+SIGSCAN_API size_t sigscan_pattern_size(const sigscan_pattern* pattern);
+
+/// Writes up to `capacity` matches into `results` and returns the total number of matches (SIGSCAN_ERROR on failure)
+SIGSCAN_API size_t sigscan_find(const sigscan_scanner* scanner, const sigscan_pattern* pattern, uint64_t* results, size_t capacity);
+
+/// Scans for several patterns in one sweep over the binary.
+/// Matches are written pattern after pattern into `results` (up to `capacity` in total),
+/// `counts[i]` receives the number of matches of `patterns[i]`. Returns the total number of matches,
+/// or SIGSCAN_ERROR if a pattern is NULL or empty (which would match every offset of the binary).
+SIGSCAN_API size_t sigscan_find_batch(
+    const sigscan_scanner* scanner, const sigscan_pattern* const* patterns, size_t pattern_count,
+    uint64_t* results, size_t capacity, size_t* counts
+);
+
+/// Generates a unique signature for the function at `address` (same as BindingsMapper).
+/// Writes a NUL-terminated string into `buffer` if it fits, and returns the length of the signature (0 if none was found)
+SIGSCAN_API size_t sigscan_generate_signature(
+    sigscan_scanner* scanner, sigscan_arch arch, uint64_t address, size_t size,
+    char* buffer, size_t buffer_size
+);
+
+#ifdef __cplusplus
+}
+#endif
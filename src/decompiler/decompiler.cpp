@@ -35,6 +35,10 @@ std::vector<PatternToken> Opcode::getSafePattern() const {
             case ZYDIS_INSTR_SEGMENT_DISPLACEMENT:
                 copyBytes(segment.offset, segment.size, true);
                 break;
+            case ZYDIS_INSTR_SEGMENT_IMMEDIATE:
+                // branch targets and addresses are wildcarded, other constants are kept as they are
+                copyBytes(segment.offset, segment.size, (zydis.relocatableBytes >> segment.offset) & 1);
+                break;
             default:
                 copyBytes(segment.offset, segment.size);
                 break;
@@ -44,6 +48,39 @@ std::vector<PatternToken> Opcode::getSafePattern() const {
     return pattern;
 }
 
+std::optional<Decompiler::Arch> Decompiler::parseArch(std::string_view name) {
+    if (name == "x32" || name == "x86")
+        return Arch::x86;
+    if (name == "x64" || name == "x86_64")
+        return Arch::x86_64;
+    if (name == "armv7" || name == "arm32")
+        return Arch::armv7;
+    if (name == "armv8" || name == "arm64")
+        return Arch::armv8;
+    return std::nullopt;
+}
+
+size_t Decompiler::getInstructionAlignment(Arch arch) {
+    // ARM64 instructions are always word aligned, so there's no point in trying other offsets
+    return arch == Arch::armv8 ? 4 : 1;
+}
+
+bool Decompiler::isAddressLike(uint64_t value, uint8_t bits) const {
+    // smaller immediates are flags, shifts, sizes, stack and field offsets and such
+    if (bits < 32)
+        return false;
+
+    // nothing tells where the image is loaded, so assume the default bases (0x400000 for 32-bit Windows,
+    // 0x100000000 on macOS and 0x140000000 for 64-bit Windows) and leave some room for sections that are bigger in memory.
+    // Float constants like 0x3F800000 (1.0f) are far enough outside of these ranges to stay exact
+    uint64_t span = scanner.size() * 2 + 0x1000000;
+    if (arch == Arch::x86)
+        return value >= 0x400000 && value < 0x400000 + span;
+
+    // 64-bit code only has pointer sized immediates in movabs, 32-bit ones are sign extended and can't reach the image
+    return bits == 64 && value >= 0x100000000 && value < 0x140000000 + span;
+}
+
 void Decompiler::decompile(uintptr_t address, size_t size, std::vector<Opcode> &opcodes) const {
     ZydisMachineMode machineMode;
     switch (arch) {
@@ -87,6 +124,42 @@ void Decompiler::decompile(uintptr_t address, size_t size, std::vector<Opcode> &
         opcode.text = std::string(text);
         opcode.bytes = std::vector<uint8_t>(data.begin() + offset, data.begin() + offset + len);
         opcode.zydis.mnemonic = ins.info.mnemonic;
+
+        // relative targets change whenever the code around them moves (except short jumps, which stay inside the function),
+        // and absolute addresses whenever the code or data they point to does
+        opcode.zydis.relocatableBytes = 0;
+        for (auto const& imm : ins.info.raw.imm) {
+            if (imm.size == 0)
+                continue;
+
+            uint64_t value = imm.size >= 64 ? imm.value.u : imm.value.u & ((uint64_t(1) << imm.size) - 1);
+            if (imm.is_relative ? imm.size >= 16 : isAddressLike(value, imm.size))
+                opcode.zydis.relocatableBytes |= static_cast<uint16_t>(((1u << (imm.size / 8)) - 1) << imm.offset);
+        }
+
+        // resolve relative branches and RIP-relative memory operands
+        for (ZyanU8 i = 0; i < ins.info.operand_count_visible; i++) {
+            auto const& operand = ins.operands[i];
+            bool isRelativeImm = operand.type == ZYDIS_OPERAND_TYPE_IMMEDIATE && operand.imm.is_relative;
+            bool isRipRelative = operand.type == ZYDIS_OPERAND_TYPE_MEMORY && operand.mem.base == ZYDIS_REGISTER_RIP;
+            if (!isRelativeImm && !isRipRelative)
+                continue;
+
+            ZyanU64 target;
+            if (!ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&ins.info, &operand, address + offset, &target)))
+                break;
+
+            opcode.reference = target;
+            if (isRelativeImm) {
+                opcode.referenceOffset = ins.info.raw.imm[0].offset;
+                opcode.referenceSize = ins.info.raw.imm[0].size / 8;
+            } else {
+                opcode.referenceOffset = ins.info.raw.disp.offset;
+                opcode.referenceSize = ins.info.raw.disp.size / 8;
+            }
+            break;
+        }
+
         opcodes.push_back(opcode);
 
         offset += len;
@@ -133,6 +206,14 @@ void Decompiler::decompileCapstone(uintptr_t address, size_t size, std::vector<O
 
             opcode.capstone.detail = ins.detail->arm64;
 
+            // b/bl targets and adrp pages are already resolved by capstone
+            if ((opcode.text == "b" || opcode.text == "bl" || opcode.text == "adrp") &&
+                opcode.capstone.detail.op_count > 0) {
+                auto const& operand = opcode.capstone.detail.operands[opcode.capstone.detail.op_count - 1];
+                if (operand.type == ARM64_OP_IMM)
+                    opcode.reference = static_cast<uintptr_t>(operand.imm);
+            }
+
             // std::cout << std::format("Decompiled: {:X} {}\n", opcode.address, opcode.text);
 
             opcodes.push_back(opcode);
@@ -1,5 +1,7 @@
 #pragma once
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <Zydis/Zydis.h>
 #include <capstone/capstone.h>
@@ -13,6 +15,8 @@ struct Opcode {
         struct ZydisInfo {
             ZydisInstructionSegments segments;
             ZydisMnemonic mnemonic;
+            /// Immediate bytes that change when the code or data they point to moves (bit per byte)
+            uint16_t relocatableBytes;
         } zydis;
 
         struct CapstoneInfo {
@@ -26,6 +30,12 @@ struct Opcode {
 
     std::vector<uint8_t> bytes;
 
+    /// Address the instruction refers to (branch target, RIP-relative operand or adrp page)
+    std::optional<uintptr_t> reference;
+    /// Offset and size of the operand encoding the reference (x86 only)
+    uint8_t referenceOffset = 0;
+    uint8_t referenceSize = 0;
+
     [[nodiscard]] std::vector<PatternToken> getSafePattern() const;
 };
 
@@ -40,9 +50,17 @@ public:
 
     Decompiler(Scanner& scanner, Arch arch) : scanner(scanner), arch(arch) {}
 
+    /// Parses an architecture name from the command line ("x86", "x64", "arm64", ...), nothing if it's unknown
+    [[nodiscard]] static std::optional<Arch> parseArch(std::string_view name);
+    /// Offsets that instructions (and so patterns) of the architecture can start at are a multiple of this
+    [[nodiscard]] static size_t getInstructionAlignment(Arch arch);
+
     void decompile(uintptr_t address, size_t size, std::vector<Opcode>& opcodes) const;
     void decompileCapstone(uintptr_t address, size_t size, std::vector<Opcode>& opcodes) const;
 private:
+    /// Whether a non-relative immediate looks like an absolute address inside the image rather than a constant
+    [[nodiscard]] bool isAddressLike(uint64_t value, uint8_t bits) const;
+
     Scanner& scanner;
     Arch arch;
 };
\ No newline at end of file
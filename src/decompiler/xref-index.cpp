@@ -0,0 +1,66 @@
+#include "xref-index.hpp"
+#include <cstring>
+
+static uint32_t toWord(const std::vector<uint8_t>& bytes) {
+    uint32_t word = 0;
+    if (bytes.size() == 4)
+        std::memcpy(&word, bytes.data(), sizeof(word));
+    return word;
+}
+
+void XrefIndex::addFunction(const std::vector<Opcode>& opcodes) {
+    std::vector<std::pair<uintptr_t, Xref>> found;
+
+    for (size_t i = 0; i < opcodes.size(); i++) {
+        const auto& opcode = opcodes[i];
+        if (!opcode.reference) continue;
+
+        if (!opcode.isCapstone) {
+            // only rel32 operands survive relinking well enough to be followed
+            if (opcode.referenceSize != 4) continue;
+            found.emplace_back(*opcode.reference, Xref {
+                opcode.address, ReferenceKind::Rel32, opcode.referenceOffset, opcode.length
+            });
+            continue;
+        }
+
+        if (opcode.text == "b" || opcode.text == "bl") {
+            found.emplace_back(*opcode.reference, Xref {
+                opcode.address, ReferenceKind::Arm64Branch, 0, opcode.length
+            });
+            continue;
+        }
+
+        // adrp is only useful together with the add that completes the address,
+        // which the compiler usually schedules within a few instructions
+        if (opcode.text == "adrp") {
+            constexpr size_t maxDistance = 4;
+            for (size_t j = i + 1; j < opcodes.size() && j <= i + maxDistance; j++) {
+                if (opcodes[j].text != "add") continue;
+                auto target = ReferenceSignature::decodeArm64AdrpAdd(
+                    opcode.address, toWord(opcode.bytes), toWord(opcodes[j].bytes)
+                );
+                if (!target) continue;
+
+                found.emplace_back(*target, Xref {
+                    opcode.address, ReferenceKind::Arm64AdrpAdd,
+                    static_cast<uint8_t>(opcodes[j].address - opcode.address), opcode.length
+                });
+                break;
+            }
+        }
+    }
+
+    if (found.empty()) return;
+
+    std::lock_guard lock(mutex);
+    for (auto& [target, xref] : found)
+        references[target].push_back(xref);
+    count += found.size();
+}
+
+std::span<const Xref> XrefIndex::getReferences(uintptr_t target) const {
+    auto it = references.find(target);
+    if (it == references.end()) return {};
+    return it->second;
+}
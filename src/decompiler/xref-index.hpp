@@ -0,0 +1,36 @@
+#pragma once
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "decompiler.hpp"
+#include "../scanner/reference.hpp"
+
+/// Instruction that references another address
+struct Xref {
+    uintptr_t address;
+    ReferenceKind kind;
+    /// Same meaning as in ReferenceSignature
+    uint8_t operandOffset;
+    uint8_t instructionLength;
+};
+
+/// Maps addresses to the instructions referencing them.
+/// Filled from decompiled functions, so it can be built in the same pass that decompiles everything.
+/// It only knows the references made by the functions added to it (the mapper adds the bound functions), not the whole binary.
+class XrefIndex {
+public:
+    /// Records all references made by a decompiled function (thread-safe)
+    void addFunction(const std::vector<Opcode>& opcodes);
+
+    /// Returns all recorded references to the target address
+    [[nodiscard]] std::span<const Xref> getReferences(uintptr_t target) const;
+
+    [[nodiscard]] size_t size() const { return count; }
+
+private:
+    std::unordered_map<uintptr_t, std::vector<Xref>> references;
+    size_t count = 0;
+    std::mutex mutex;
+};
@@ -0,0 +1,443 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+
+#include "scanner/scanner.hpp"
+#include "scanner/reference.hpp"
+#include "decompiler/decompiler.hpp"
+#include "bindings/pattern-importer.hpp"
+#include "utils/memory-stats.hpp"
+#include "utils/thread-pool.hpp"
+
+struct EvalPattern {
+    uintptr_t offset;
+    std::string name;
+    std::vector<PatternToken> tokens;
+    std::optional<ReferenceSignature> reference;
+};
+
+struct EvalBinary {
+    std::string name;
+    std::unique_ptr<Scanner> scanner;
+    /// matches of every pattern (already followed to the function for xref signatures)
+    std::vector<std::vector<uintptr_t>> hits;
+};
+
+bool loadPatterns(const std::string& patternsPath, std::vector<EvalPattern>& patterns) {
+    std::ifstream patternsFile(patternsPath);
+    if (!patternsFile.is_open()) {
+        std::cerr << "Failed to open patterns file: " << patternsPath << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(patternsFile, line)) {
+        auto parts = PatternImporter::split(line, ',');
+        if (parts.size() != 3) {
+            std::cerr << "Invalid line: " << line << std::endl;
+            continue;
+        }
+
+        EvalPattern pattern;
+        try {
+            pattern.offset = std::stoll(parts[0], nullptr, 16);
+        } catch (const std::exception&) {
+            std::cerr << "Invalid line: " << line << std::endl;
+            continue;
+        }
+        pattern.name = parts[1];
+        if (ReferenceSignature::isReference(parts[2])) {
+            pattern.reference = ReferenceSignature::fromString(parts[2]);
+            if (!pattern.reference) {
+                std::cerr << "Invalid line: " << line << std::endl;
+                continue;
+            }
+            pattern.tokens = pattern.reference->pattern;
+        } else {
+            try {
+                pattern.tokens = PatternToken::fromString(parts[2]);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid line: " << line << std::endl;
+                continue;
+            }
+        }
+        patterns.push_back(std::move(pattern));
+    }
+
+    return true;
+}
+
+/// Random binaries and patterns for checking the fast scan paths against Scanner::findReference
+class ScanFuzzer {
+public:
+    explicit ScanFuzzer(uint32_t seed) : rng(seed) {}
+
+    /// Runs one random case, returns false (and prints the case) on a mismatch
+    bool runCase() {
+        // a small alphabet makes partial and overlapping matches common,
+        // and a few big buffers cross the findBatch chunk boundaries
+        size_t size = random(16) == 0 ? random(600 * 1024) : random(4096);
+        int alphabet = random(2) ? 4 : 256;
+        std::vector<uint8_t> data(size);
+        for (auto& byte : data)
+            byte = static_cast<uint8_t>(random(alphabet));
+
+        auto base = static_cast<intptr_t>(random(0x2000)) - 0x1000;
+        Scanner scanner(data, base);
+        constexpr size_t alignments[] = {1, 2, 3, 4, 8};
+        scanner.setAlignment(alignments[random(std::size(alignments))]);
+
+        std::vector<std::vector<PatternToken>> patterns(1 + random(8));
+        for (auto& pattern : patterns)
+            pattern = randomPattern(data);
+
+        std::vector<std::vector<uintptr_t>> batch;
+        scanner.findBatch(patterns, batch);
+
+        for (size_t i = 0; i < patterns.size(); i++) {
+            const auto& pattern = patterns[i];
+            auto text = PatternToken::fromPatternTokens(pattern);
+
+            std::vector<uintptr_t> expected, found, compiled;
+            scanner.findReference(pattern, expected);
+            scanner.find(pattern, found);
+            scanner.find(CompiledPattern(pattern), compiled);
+
+            // narrowing the matches of a prefix has to give the same result as a full scan
+            std::vector<PatternToken> prefix(pattern.begin(), pattern.begin() + random(pattern.size() + 1));
+            std::vector<uintptr_t> filtered;
+            scanner.findReference(prefix, filtered);
+            scanner.filter(CompiledPattern(pattern), filtered);
+
+            // trailing wildcards are dropped when printing, so compare the significant part only
+            bool roundTrip = PatternToken::fromPatternTokens(PatternToken::fromString(text)) == text;
+
+            if (found != expected || compiled != expected || batch[i] != expected || filtered != expected || !roundTrip) {
+                std::cerr << std::format(
+                    "Mismatch for pattern '{}' (size {}, base {}, alignment {}): reference {}, find {}, compiled {}, batch {}, filter {}, round trip {}\n",
+                    text, size, base, scanner.getAlignment(), expected.size(), found.size(), compiled.size(),
+                    batch[i].size(), filtered.size(), roundTrip ? "ok" : "failed"
+                );
+                return false;
+            }
+        }
+
+        return fuzzPatternString();
+    }
+
+private:
+    size_t random(size_t bound) {
+        return bound == 0 ? 0 : std::uniform_int_distribution<size_t>(0, bound - 1)(rng);
+    }
+
+    std::vector<PatternToken> randomPattern(std::span<const uint8_t> data) {
+        size_t length = random(25);
+        std::vector<PatternToken> pattern;
+
+        // mostly copy real bytes (often right at the end of the buffer), so there is something to find
+        bool copy = !data.empty() && random(4) != 0;
+        size_t start = 0;
+        if (copy) {
+            start = random(2) ? data.size() - std::min(data.size(), length + random(4)) : random(data.size());
+            length = std::min(length, data.size() - start);
+        }
+
+        for (size_t i = 0; i < length; i++) {
+            auto byte = copy ? data[start + i] : static_cast<uint8_t>(random(256));
+            switch (random(8)) {
+                case 0: pattern.push_back(PatternToken::wildcard()); break;
+                case 1: pattern.push_back(PatternToken::fromByteMask(byte, static_cast<uint8_t>(random(256)))); break;
+                case 2: pattern.push_back(PatternToken::fromByteMask(byte, random(2) ? 0xF0 : 0x0F)); break;
+                default: pattern.push_back(PatternToken::fromByte(byte)); break;
+            }
+        }
+        return pattern;
+    }
+
+    /// Malformed patterns may only throw std::invalid_argument, and anything accepted has to survive a round trip
+    bool fuzzPatternString() {
+        constexpr std::string_view characters = "0123456789abcdefABCDEF?& xZ";
+        std::string text;
+        for (size_t i = random(24); i > 0; i--)
+            text += characters[random(characters.size())];
+
+        std::string printed;
+        try {
+            printed = PatternToken::fromPatternTokens(PatternToken::fromString(text));
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+
+        if (PatternToken::fromPatternTokens(PatternToken::fromString(printed)) != printed) {
+            std::cerr << std::format("Pattern '{}' didn't survive a round trip (printed as '{}')\n", text, printed);
+            return false;
+        }
+        return true;
+    }
+
+    std::mt19937 rng;
+};
+
+int runFuzz(size_t iterations, uint32_t seed) {
+    std::cout << std::format("Fuzzing {} cases with seed {}\n", iterations, seed);
+
+    ScanFuzzer fuzzer(seed);
+    size_t failed = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        if (!fuzzer.runCase())
+            ++failed;
+    }
+
+    std::cout << std::format("{}/{} cases passed\n", iterations - failed, iterations);
+    return failed == 0 ? 0 : 1;
+}
+
+/// Instruction and the pattern Opcode::getSafePattern should turn it into
+struct DecoderCase {
+    Decompiler::Arch arch;
+    std::vector<uint8_t> bytes;
+    std::string_view expected;
+};
+
+/// Checks which immediates get wildcarded for a few known instructions:
+/// relative targets (except rel8) and absolute addresses inside the image, but not plain constants
+int runDecoderCheck() {
+    using enum Decompiler::Arch;
+    const std::vector<DecoderCase> cases = {
+        // push 0x401000
+        { x86, { 0x68, 0x00, 0x10, 0x40, 0x00 }, "68 ? ? ? ?" },
+        // push 0x3F800000 (1.0f)
+        { x86, { 0x68, 0x00, 0x00, 0x80, 0x3F }, "68 00 00 80 3F" },
+        // cmp ecx, 0x403000
+        { x86, { 0x81, 0xF9, 0x00, 0x30, 0x40, 0x00 }, "81 F9 ? ? ? ?" },
+        // mov eax, 0x10
+        { x86, { 0xB8, 0x10, 0x00, 0x00, 0x00 }, "B8 10 00 00 00" },
+        // push 0x10
+        { x86, { 0x6A, 0x10 }, "6A 10" },
+        // ret 0x10
+        { x86, { 0xC2, 0x10, 0x00 }, "C2 10 00" },
+        // call rel32
+        { x86, { 0xE8, 0x10, 0x00, 0x00, 0x00 }, "E8 ? ? ? ?" },
+        // jmp rel16
+        { x86, { 0x66, 0xE9, 0x10, 0x00 }, "66 E9 ? ?" },
+        // jmp rel8
+        { x86, { 0xEB, 0x05 }, "EB 05" },
+
+        // mov rax, 0x140001000
+        { x86_64, { 0x48, 0xB8, 0x00, 0x10, 0x00, 0x40, 0x01, 0x00, 0x00, 0x00 }, "48 B8 ? ? ? ? ? ? ? ?" },
+        // mov rax, 0x3FF0000000000000 (1.0)
+        { x86_64, { 0x48, 0xB8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F }, "48 B8 00 00 00 00 00 00 F0 3F" },
+        // mov eax, 0x401000
+        { x86_64, { 0xB8, 0x00, 0x10, 0x40, 0x00 }, "B8 00 10 40 00" },
+        // mov rax, 0x401000 (sign extended)
+        { x86_64, { 0x48, 0xC7, 0xC0, 0x00, 0x10, 0x40, 0x00 }, "48 C7 C0 00 10 40 00" },
+        // sub rsp, 0x28
+        { x86_64, { 0x48, 0x83, 0xEC, 0x28 }, "48 83 EC 28" },
+        // call rel32
+        { x86_64, { 0xE8, 0x10, 0x00, 0x00, 0x00 }, "E8 ? ? ? ?" },
+        // je rel32
+        { x86_64, { 0x0F, 0x84, 0x10, 0x00, 0x00, 0x00 }, "0F 84 ? ? ? ?" },
+        // je rel8
+        { x86_64, { 0x74, 0x05 }, "74 05" },
+    };
+
+    size_t failed = 0;
+    for (const auto& test : cases) {
+        Scanner scanner(test.bytes, 0);
+        Decompiler decompiler(scanner, test.arch);
+
+        std::vector<Opcode> opcodes;
+        decompiler.decompile(0, test.bytes.size(), opcodes);
+
+        std::vector<PatternToken> pattern;
+        if (opcodes.size() == 1)
+            pattern = opcodes[0].getSafePattern();
+        if (pattern == PatternToken::fromString(test.expected))
+            continue;
+
+        std::cerr << std::format(
+            "{} ({}): expected '{}', got '{}'\n",
+            opcodes.empty() ? "?" : opcodes[0].text, test.arch == x86 ? "x86" : "x64",
+            test.expected, PatternToken::fromPatternTokens(pattern)
+        );
+        ++failed;
+    }
+
+    std::cout << std::format("{}/{} instructions decoded as expected\n", cases.size() - failed, cases.size());
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 2 && std::string_view(argv[1]) == "--check-decoder")
+        return runDecoderCheck();
+
+    if (argc > 1 && std::string_view(argv[1]) == "--fuzz") {
+        if (argc != 3 && argc != 4) {
+            std::cerr << "Usage: " << argv[0] << " --fuzz <iterations> [seed]" << std::endl;
+            return 1;
+        }
+        auto seed = argc == 4 ? static_cast<uint32_t>(std::stoul(argv[3])) : std::random_device()();
+        return runFuzz(std::stoul(argv[2]), seed);
+    }
+
+    auto loadMode = MappedFile::LoadMode::Map;
+    if (argc > 1 && std::string_view(argv[1]).starts_with("--load=")) {
+        auto mode = MappedFile::parseLoadMode(std::string_view(argv[1]).substr(7));
+        if (!mode) {
+            std::cerr << "Invalid load mode: " << argv[1] + 7 << std::endl;
+            return 1;
+        }
+        loadMode = *mode;
+
+        // drop the option, so the positional arguments stay where they are
+        argv[1] = argv[0];
+        ++argv;
+        --argc;
+    }
+
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " [--load=map|populate|hugepages] <patterns> <report> (<binary-path> <file-offset> [arch=x64])..." << std::endl;
+        std::cerr << "       " << argv[0] << " --fuzz <iterations> [seed]" << std::endl;
+        std::cerr << "       " << argv[0] << " --check-decoder" << std::endl;
+        std::cerr << "Example: " << argv[0] << " output2206.csv report.csv GeometryDash2205.exe 0xC00 GeometryDash2206.exe 0xC00 GeometryDash2207.exe 0xC00" << std::endl;
+        return 1;
+    }
+
+    std::string patternsPath = argv[1];
+    std::string reportPath = argv[2];
+
+    std::vector<EvalPattern> patterns;
+    if (!loadPatterns(patternsPath, patterns))
+        return 1;
+
+    std::vector<EvalBinary> binaries;
+    size_t totalSize = 0;
+    MemoryStats memoryStats;
+    for (int i = 3; i < argc;) {
+        if (i + 1 >= argc) {
+            std::cerr << "Missing file offset for: " << argv[i] << std::endl;
+            return 1;
+        }
+
+        auto file = MappedFile::open(argv[i], loadMode);
+        if (!file) {
+            std::cerr << "Failed to open binary file: " << argv[i] << std::endl;
+            return 1;
+        }
+
+        // the architecture is optional, anything else starts the next binary
+        auto arch = i + 2 < argc ? Decompiler::parseArch(argv[i + 2]) : std::nullopt;
+
+        EvalBinary binary;
+        binary.name = std::filesystem::path(argv[i]).filename().string();
+        binary.scanner = std::make_unique<Scanner>(file, std::stoll(argv[i + 1], nullptr, 16));
+        // match only where the importer would, or survival counts hits it never sees
+        binary.scanner->setAlignment(Decompiler::getInstructionAlignment(arch.value_or(Decompiler::Arch::x86_64)));
+        i += arch ? 3 : 2;
+        binary.hits.resize(patterns.size());
+        totalSize += binary.scanner->size();
+        binaries.push_back(std::move(binary));
+    }
+
+    std::ofstream reportFile(reportPath);
+    if (!reportFile.is_open()) {
+        std::cerr << "Failed to open report file: " << reportPath << std::endl;
+        return 1;
+    }
+
+    std::cout << std::format("Evaluating {} patterns against {} binaries\n", patterns.size(), binaries.size());
+
+    // every task scans one batch of patterns in one binary
+    constexpr size_t batchSize = 64;
+
+    ThreadPool pool;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (auto& binary : binaries) {
+        for (size_t first = 0; first < patterns.size(); first += batchSize) {
+            pool.addTask([&binary, &patterns, first] {
+                size_t last = std::min(first + batchSize, patterns.size());
+
+                std::vector<std::vector<PatternToken>> batch;
+                batch.reserve(last - first);
+                for (size_t i = first; i < last; i++)
+                    batch.push_back(patterns[i].tokens);
+
+                std::vector<std::vector<uintptr_t>> results;
+                binary.scanner->findBatch(batch, results);
+
+                for (size_t i = first; i < last; i++) {
+                    auto& hits = binary.hits[i];
+                    if (!patterns[i].reference) {
+                        hits = std::move(results[i - first]);
+                        continue;
+                    }
+
+                    for (auto site : results[i - first]) {
+                        if (auto target = patterns[i].reference->resolve(*binary.scanner, site))
+                            hits.push_back(*target);
+                    }
+                }
+            });
+        }
+    }
+    pool.runAllTasks();
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    // report: one row per pattern, with hit count and drift of the closest hit for every binary.
+    // a pattern "survives" a binary when the importer would accept it there (exactly one hit close to the original offset)
+    reportFile << "offset,name,length,survival";
+    for (const auto& binary : binaries)
+        reportFile << std::format(",{0} hits,{0} drift", binary.name);
+    reportFile << "\n";
+
+    size_t survivedAll = 0, survivedNone = 0;
+    double survivalSum = 0;
+    for (size_t i = 0; i < patterns.size(); i++) {
+        const auto& pattern = patterns[i];
+
+        std::string columns;
+        size_t survived = 0;
+        for (const auto& binary : binaries) {
+            const auto& hits = binary.hits[i];
+
+            std::optional<intptr_t> drift;
+            size_t nearby = 0;
+            for (auto hit : hits) {
+                auto distance = static_cast<intptr_t>(hit - pattern.offset);
+                if (!drift || std::abs(distance) < std::abs(*drift))
+                    drift = distance;
+                if (static_cast<uintptr_t>(std::abs(distance)) <= PatternImporter::maxDistance)
+                    ++nearby;
+            }
+
+            if (nearby == 1)
+                ++survived;
+
+            columns += std::format(",{},{}", hits.size(), drift ? std::to_string(*drift) : "");
+        }
+
+        double survival = static_cast<double>(survived) / static_cast<double>(binaries.size());
+        survivalSum += survival;
+        if (survived == binaries.size()) ++survivedAll;
+        if (survived == 0) ++survivedNone;
+
+        reportFile << std::format("0x{:X},{},{},{:.2f}{}\n", pattern.offset, pattern.name, pattern.tokens.size(), survival, columns);
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    double seconds = std::max<double>(static_cast<double>(elapsed), 1.0) / 1000.0;
+    double scannedMb = static_cast<double>(totalSize) * static_cast<double>(patterns.size()) / (1024.0 * 1024.0);
+
+    std::cout << std::format("Mean survival: {:.2f}%\n", patterns.empty() ? 0.0 : survivalSum * 100.0 / static_cast<double>(patterns.size()));
+    std::cout << std::format("Survived all binaries: {}/{}\n", survivedAll, patterns.size());
+    std::cout << std::format("Survived no binaries: {}/{}\n", survivedNone, patterns.size());
+    std::cout << std::format("Time taken: {}ms\n", elapsed);
+    std::cout << std::format("Throughput: {:.0f} scans/s, {:.1f} MB/s\n", static_cast<double>(patterns.size() * binaries.size()) / seconds, scannedMb / seconds);
+    std::cout << memoryStats.summary() << std::endl;
+
+    return 0;
+}
@@ -3,13 +3,94 @@
 #include <optional>
 #include <string>
 #include "scanner/scanner.hpp"
+#include "decompiler/decompiler.hpp"
+#include "bindings/pattern-importer.hpp"
+#include "bindings/broma-merger.hpp"
+#include "server/pattern-server.hpp"
 
-std::vector<std::string> split(std::string_view str, char i);
+int serve(int argc, char** argv) {
+    // importer.exe --serve <socket-path> [<name> <binary-path> <file-offset> [arch=x64]]...
+    PatternServer server(argv[2]);
+    for (int i = 3; i < argc;) {
+        if (i + 2 >= argc) {
+            std::cerr << "Expected <name> <binary-path> <file-offset> [arch] for every binary" << std::endl;
+            return 1;
+        }
+
+        // the architecture is optional, anything else starts the next binary
+        auto arch = i + 3 < argc ? Decompiler::parseArch(argv[i + 3]) : std::nullopt;
+        std::cout << std::format("Loading {} as {}\n", argv[i + 1], argv[i]);
+
+        std::string error;
+        if (!server.load(argv[i], argv[i + 1], std::stoll(argv[i + 2], nullptr, 16), arch.value_or(Decompiler::Arch::x86_64), error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        i += arch ? 4 : 3;
+    }
+
+    return server.run() ? 0 : 1;
+}
+
+int merge(int argc, char** argv) {
+    // importer.exe --merge <old-broma> <new-broma> <output-broma> <found> <platform> [old-platform]
+    std::string oldPath = argv[2];
+    std::string newPath = argv[3];
+    std::string outputPath = argv[4];
+    std::string foundPath = argv[5];
+    std::string platform = argv[6];
+    std::string oldPlatform = argc == 8 ? argv[7] : platform;
+
+    std::ifstream foundFile(foundPath);
+    if (!foundFile.is_open()) {
+        std::cerr << "Failed to open found file: " << foundPath << std::endl;
+        return 1;
+    }
+
+    std::ifstream oldFile(oldPath);
+    if (!oldFile.is_open()) {
+        std::cerr << "Failed to open broma file: " << oldPath << std::endl;
+        return 1;
+    }
+
+    std::ifstream newFile(newPath);
+    if (!newFile.is_open()) {
+        std::cerr << "Failed to open broma file: " << newPath << std::endl;
+        return 1;
+    }
+
+    std::ofstream outputFile(outputPath);
+    if (!outputFile.is_open()) {
+        std::cerr << "Failed to open output file: " << outputPath << std::endl;
+        return 1;
+    }
+
+    auto found = BromaMerger::readFound(foundFile);
+
+    BromaMerger merger(platform);
+    merger.loadOrigins(oldFile, oldPlatform, found);
+    std::cout << std::format("Matched {}/{} found addresses to functions\n", merger.size(), found.size());
+
+    auto stats = merger.merge(newFile, outputFile);
+    std::cout << std::format(
+        "Added: {}, existed: {}, different: {}, skipped: {}, unmatched: {}\n",
+        stats.added, stats.existed, stats.different, stats.skipped, stats.unmatched
+    );
+    return 0;
+}
 
 int main(int argc, char** argv) {
+    if (argc >= 3 && std::string_view(argv[1]) == "--serve")
+        return serve(argc, argv);
+
+    if ((argc == 7 || argc == 8) && std::string_view(argv[1]) == "--merge")
+        return merge(argc, argv);
+
     // importer.exe <binary-path> <> <bindings-origin-path> <bindings-target-path> <file-offset>
-    if (argc != 5) {
-        std::cerr << "Usage: " << argv[0] << " <binary-path> <patterns> <output> <file-offset>" << std::endl;
+    if (argc != 5 && argc != 6) {
+        std::cerr << "Usage: " << argv[0] << " <binary-path> <patterns> <output> <file-offset> [arch=x64]" << std::endl;
+        std::cerr << "       " << argv[0] << " --serve <socket-path> [<name> <binary-path> <file-offset> [arch=x64]]..." << std::endl;
+        std::cerr << "       " << argv[0] << " --merge <old-broma> <new-broma> <output-broma> <found> <platform> [old-platform]" << std::endl;
         std::cerr << "Example: " << argv[0] << " GeometryDash2203.exe output2204.csv found2203.csv -0xC00" << std::endl;
         return 1;
     }
@@ -18,22 +99,26 @@ int main(int argc, char** argv) {
     std::string patternsPath = argv[2];
     std::string outputPath = argv[3];
     int64_t fileOffset = std::stoll(argv[4], nullptr, 16);
+    std::string_view arch = argc == 6 ? argv[5] : "x64";
+    auto decompilerArch = Decompiler::parseArch(arch);
+    if (!decompilerArch) {
+        std::cerr << "Invalid architecture: " << arch << std::endl;
+        return 1;
+    }
 
     std::cout << "Binary path: " << binaryPath << std::endl;
     std::cout << "Patterns path: " << patternsPath << std::endl;
     std::cout << "Output path: " << outputPath << std::endl;
     std::cout << "File offset: " << fileOffset << std::endl;
 
-    std::ifstream binaryFile(binaryPath, std::ios::binary);
-    if (!binaryFile.is_open()) {
+    auto binaryFile = MappedFile::open(binaryPath);
+    if (!binaryFile) {
         std::cerr << "Failed to open binary file: " << binaryPath << std::endl;
         return 1;
     }
 
-    Scanner scanner(
-        (std::vector<uint8_t>(std::istreambuf_iterator<char>(binaryFile), std::istreambuf_iterator<char>())),
-        fileOffset
-    );
+    Scanner scanner(binaryFile, fileOffset);
+    scanner.setAlignment(Decompiler::getInstructionAlignment(*decompilerArch));
 
     std::ifstream patternsFile(patternsPath);
     if (!patternsFile.is_open()) {
@@ -49,52 +134,25 @@ int main(int argc, char** argv) {
 
     std::string line;
     while (std::getline(patternsFile, line)) {
-        auto parts = split(line, ',');
-        if (parts.size() != 3) {
-            std::cerr << "Invalid line: " << line << std::endl;
-            continue;
-        }
-
-        uintptr_t offset = std::stoll(parts[0], nullptr, 16);
-        const auto& name = parts[1];
-        const auto& pattern = parts[2];
-
-        auto results = std::vector<uintptr_t>();
-        if (scanner.find(pattern, results)) {
-            // filter out results that are too far away from original offset
-            constexpr auto maxDistance = 0x50000;
-            std::erase_if(results, [offset, maxDistance](uintptr_t result) {
-                if (result < offset)
-                    return offset - result > maxDistance;
-                return result - offset > maxDistance;
-            });
-
-            if (results.size() > 1) {
-                std::cerr << std::format("Multiple results found: {:X} {}\n", offset, name);
-                continue;
-            }
-
-            for (auto result : results) {
+        auto result = PatternImporter::importLine(scanner, line);
+        switch (result.status) {
+            case ImportResult::Status::Found:
                 // output:
                 // offset in original binary,name,new offset in new binary
-                outputFile << std::format("{:X},{},{:X}\n", offset, name, result);
-                std::cout << std::format("Found: {:X} {} at {:X}\n", offset, name, result);
-            }
-        } else {
-            std::cerr << std::format("Pattern not found: {:X} {}\n", offset, name);
+                outputFile << std::format("{:X},{},{:X}\n", result.offset, result.name, result.address);
+                std::cout << std::format("Found: {:X} {} at {:X}\n", result.offset, result.name, result.address);
+                break;
+            case ImportResult::Status::NotFound:
+                std::cerr << std::format("Pattern not found: {:X} {}\n", result.offset, result.name);
+                break;
+            case ImportResult::Status::Multiple:
+                std::cerr << std::format("Multiple results found: {:X} {}\n", result.offset, result.name);
+                break;
+            case ImportResult::Status::OutOfRange:
+                break;
+            case ImportResult::Status::Invalid:
+                std::cerr << "Invalid line: " << line << std::endl;
+                break;
         }
     }
 }
-
-std::vector<std::string> split(std::string_view str, char i) {
-    std::vector<std::string> parts;
-    size_t start = 0;
-    size_t end = str.find(i);
-    while (end != std::string::npos) {
-        parts.emplace_back(str.substr(start, end - start));
-        start = end + 1;
-        end = str.find(i, start);
-    }
-    parts.emplace_back(str.substr(start, end));
-    return parts;
-}
@@ -1,221 +1,423 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
 #include <iostream>
 #include <fstream>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <stop_token>
 #include <thread>
+#include <unordered_map>
 
 #include "scanner/scanner.hpp"
+#include "scanner/universal.hpp"
 #include "decompiler/decompiler.hpp"
+#include "decompiler/xref-index.hpp"
+#include "bindings/signature-finder.hpp"
+#include "utils/memory-stats.hpp"
+#include "utils/thread-pool.hpp"
 
-struct FunctionSignature {
+struct SearchTask {
     std::string name;
-    std::string signature;
+    uintptr_t address;
+    size_t size;
+
+    SearchTask(std::string name, uintptr_t address, size_t size)
+        : name(std::move(name)), address(address), size(size) {}
+
+    bool finished = false;
+    std::optional<FunctionSignature> signature = std::nullopt;
+
+    /// Hash of the function body, used to spot functions that can't have a unique pattern
+    uint64_t bodyHash = 0;
+    bool duplicate = false;
+    /// Cancels the task, whether it's still queued or already searching
+    std::stop_source stop;
 };
 
-std::optional<FunctionSignature> findSignature(std::string_view name, uintptr_t address, size_t size, const Scanner& scanner, const Decompiler& decompiler) {
-    std::vector<Opcode> opcodes;
-    decompiler.decompile(address, size, opcodes);
+/// Binary (or a slice of a universal binary) to generate patterns for
+struct MappingJob {
+    std::string label;
+    Scanner scanner;
+    Decompiler decompiler;
+    XrefIndex xrefs;
+    std::vector<SearchTask> tasks;
 
-    std::vector<PatternToken> pattern;
-    for (const auto& opcode : opcodes) {
-        // add opcode to pattern and check if it matches any of the signatures
-        auto opcodePattern = opcode.getSafePattern();
-        pattern.insert(pattern.end(), opcodePattern.begin(), opcodePattern.end());
+    std::string outputPath;
+    std::ofstream outputFile;
+    std::mutex outputMutex;
 
-        // scan for the pattern
-        std::vector<uintptr_t> results;
-        if (!scanner.find(pattern, results))
-            return std::nullopt;
+    std::atomic<int> count = 0, total = 0, failed = 0, viaXref = 0, cancelled = 0;
+    /// sum of the sizes of finished tasks, for the progress estimate
+    std::atomic<size_t> doneSize = 0;
+    size_t duplicates = 0;
 
-        // check if only one result was found
-        if (results.size() != 1)
-            continue;
+    MappingJob(std::string label, std::shared_ptr<const MappedFile> binary, size_t offset, size_t size, int64_t fileOffset, Decompiler::Arch arch)
+        : label(std::move(label)), scanner(std::move(binary), fileOffset, offset, size), decompiler(scanner, arch) {}
 
-        // construct the function signature
-        FunctionSignature signature;
-        signature.name = std::string(name);
-        signature.signature = PatternToken::fromPatternTokens(pattern);
-        return signature;
+    void writeToFile(const std::string& text) {
+        std::lock_guard lock(outputMutex);
+        outputFile << text;
     }
+};
 
-    return std::nullopt;
+bool loadBindings(const std::string& bindingsPath, std::vector<SearchTask>& tasks) {
+    std::ifstream bindingsFile(bindingsPath);
+    if (!bindingsFile.is_open()) {
+        std::cerr << "Failed to open bindings file: " << bindingsPath << std::endl;
+        return false;
+    }
+
+    // CSV format: <name>,<address>,<size>
+    std::string line;
+    std::getline(bindingsFile, line); // skip header
+    while (std::getline(bindingsFile, line)) {
+        auto commaPos = line.find(',');
+        if (commaPos == std::string::npos) {
+            std::cerr << "Invalid line in bindings file: " << line << std::endl;
+            return false;
+        }
+
+        std::string name = line.substr(0, commaPos);
+        uintptr_t address = std::stoul(line.substr(commaPos + 1, line.find(',', commaPos + 1) - commaPos - 1), nullptr);
+        size_t size = std::stoul(line.substr(line.find(',', commaPos + 1) + 1), nullptr);
+
+        tasks.emplace_back(name, address, size);
+    }
+
+    return true;
 }
 
-struct SearchTask {
-    std::string name;
-    uintptr_t address;
-    size_t size;
+std::unique_ptr<MappingJob> createJob(
+    std::string label, std::shared_ptr<const MappedFile> binary, size_t offset, size_t size, std::string_view arch,
+    const std::string& bindingsPath, const std::string& outputPath, const std::string& fileOffsetStr
+) {
+    int64_t fileOffset = std::stoll(fileOffsetStr, nullptr, 16);
 
-    SearchTask(std::string name, uintptr_t address, size_t size)
-        : name(std::move(name)), address(address), size(size) {}
+    std::cout << std::format("[{}] Bindings path: {}\n", label, bindingsPath);
+    std::cout << std::format("[{}] Output path: {}\n", label, outputPath);
+    std::cout << std::format("[{}] File offset: {}\n", label, fileOffset);
 
-    bool finished = false;
-    std::optional<FunctionSignature> signature = std::nullopt;
-};
+    // the offset is given for the whole file, like for the importer, but the scanner only sees the slice
+    fileOffset -= static_cast<int64_t>(offset);
+
+    auto decompilerArch = Decompiler::parseArch(arch);
+    if (!decompilerArch) {
+        std::cerr << "Invalid architecture: " << arch << std::endl;
+        return nullptr;
+    }
 
-class ThreadPool {
-public:
-    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) : m_threads(threads) {}
+    auto job = std::make_unique<MappingJob>(std::move(label), std::move(binary), offset, size, fileOffset, *decompilerArch);
 
-    void addTask(std::function<void()>&& task) {
-        m_tasks.push_back(std::move(task));
+    job->scanner.setAlignment(Decompiler::getInstructionAlignment(*decompilerArch));
+    if (!loadBindings(bindingsPath, job->tasks))
+        return nullptr;
+
+    job->outputPath = outputPath;
+    job->outputFile.open(outputPath);
+    if (!job->outputFile.is_open()) {
+        std::cerr << "Failed to open output file: " << outputPath << std::endl;
+        return nullptr;
     }
 
-    void runAllTasks() {
-        // create threads
-        for (size_t i = 0; i < m_threads; i++) {
-            m_workers.emplace_back([this]() {
-                while (true) {
-                    std::function<void()> task;
-                    {
-                        std::lock_guard lock(m_tasksMutex);
-                        if (m_tasks.empty())
-                            break;
+    return job;
+}
 
-                        task = std::move(m_tasks.back());
-                        m_tasks.pop_back();
-                    }
+/// Marks functions whose whole body matches another function, and writes them to <output>.duplicates.csv
+bool markDuplicates(MappingJob& job) {
+    std::unordered_map<uint64_t, std::vector<SearchTask*>> groups;
+    for (auto& task : job.tasks) {
+        if (task.bodyHash != 0)
+            groups[task.bodyHash].push_back(&task);
+    }
 
-                    task();
-                }
-            });
-        }
+    std::string reportPath = job.outputPath + ".duplicates.csv";
+    std::ofstream report(reportPath);
+    if (!report.is_open()) {
+        std::cerr << "Failed to open duplicates file: " << reportPath << std::endl;
+        return false;
+    }
 
-        // join threads
-        for (auto& worker : m_workers) {
-            worker.join();
+    report << "Hash,Address,Name,Size\n";
+    for (auto& [hash, tasks] : groups) {
+        if (tasks.size() < 2) continue;
+        for (auto* task : tasks) {
+            task->duplicate = true;
+            report << std::format("{:016X},0x{:X},{},{}\n", hash, task->address, task->name, task->size);
+            ++job.duplicates;
         }
     }
 
-private:
-    size_t m_threads;
-    std::vector<std::thread> m_workers;
-    std::vector<std::function<void()>> m_tasks;
-    std::mutex m_tasksMutex;
+    return true;
+}
+
+struct MapperOptions {
+    SignatureOptions signature;
+    MappedFile::LoadMode loadMode = MappedFile::LoadMode::Map;
+    bool progress = true;
 };
 
-int main(int argc, char* argv[]) {
-    if (argc != 5 && argc != 6) {
-        std::cerr << "Usage: " << argv[0] << " <binary-path> <bindings-path> <output> <file-offset> [arch=x64]" << std::endl;
-        std::cerr << "Example: " << argv[0] << " GeometryDash.exe funcs.csv output.txt -0xC00 x32" << std::endl;
-        return 1;
+/// Parses the value of a numeric option, printing an error if it isn't a number
+std::optional<size_t> parseCount(std::string_view option, std::string_view value) {
+    try {
+        // stoull would silently wrap negative numbers around
+        size_t end = 0;
+        auto result = std::stoull(std::string(value), &end);
+        if (end == value.size() && !value.starts_with('-'))
+            return result;
+    } catch (const std::exception&) {}
+
+    std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+    return std::nullopt;
+}
+
+/// Parses `--name=value` options, removing them from the argument list
+bool parseOptions(std::vector<std::string_view>& args, MapperOptions& options) {
+    for (auto it = args.begin(); it != args.end();) {
+        if (it->starts_with("--max-stalled=")) {
+            auto value = parseCount("--max-stalled", it->substr(14));
+            if (!value) return false;
+            options.signature.maxStalledOpcodes = *value;
+        } else if (it->starts_with("--time-budget=")) {
+            auto value = parseCount("--time-budget", it->substr(14));
+            if (!value) return false;
+            options.signature.timeBudget = std::chrono::milliseconds(*value);
+        } else if (it->starts_with("--scan-budget=")) {
+            auto value = parseCount("--scan-budget", it->substr(14));
+            if (!value) return false;
+            options.signature.scanBudget = *value;
+        } else if (*it == "--no-progress") {
+            options.progress = false;
+        } else if (it->starts_with("--load=")) {
+            auto mode = MappedFile::parseLoadMode(it->substr(7));
+            if (!mode) {
+                std::cerr << "Invalid load mode: " << it->substr(7) << std::endl;
+                return false;
+            }
+            options.loadMode = *mode;
+        } else if (it->starts_with("--") && *it != "--universal") {
+            std::cerr << "Unknown option: " << *it << std::endl;
+            return false;
+        } else {
+            ++it;
+            continue;
+        }
+        it = args.erase(it);
     }
+    return true;
+}
 
-    std::string binaryPath = argv[1];
-    std::string bindingsPath = argv[2];
-    std::string outputPath = argv[3];
-    int64_t fileOffset = std::stoll(argv[4], nullptr, 16);
-    std::string arch = argc == 6 ? argv[5] : "x64";
+/// Set on Ctrl+C, which cancels every task and ends the run with what was found so far
+std::atomic<bool> interrupted = false;
 
-    std::cout << "Binary path: " << binaryPath << std::endl;
-    std::cout << "Bindings path: " << bindingsPath << std::endl;
-    std::cout << "Output path: " << outputPath << std::endl;
-    std::cout << "File offset: " << fileOffset << std::endl;
+void onInterrupt(int) {
+    interrupted = true;
+    // a second Ctrl+C kills the process as usual
+    std::signal(SIGINT, SIG_DFL);
+}
 
-    std::ifstream binaryFile(binaryPath, std::ios::binary);
-    if (!binaryFile.is_open()) {
-        std::cerr << "Failed to open binary file: " << binaryPath << std::endl;
-        return 1;
+/// Runs next to the search: cancels the tasks once interrupted, and prints how far along the search is.
+/// Functions take time roughly in proportion to their size, so the ETA is based on how much code was processed
+void monitorSearch(std::stop_token stop, const std::vector<std::unique_ptr<MappingJob>>& jobs, bool showProgress) {
+    size_t totalSize = 0, totalTasks = 0;
+    for (const auto& job : jobs) {
+        for (const auto& task : job->tasks)
+            totalSize += task.size;
+        totalTasks += job->tasks.size();
     }
 
-    Scanner scanner(
-        (std::vector<uint8_t>(std::istreambuf_iterator(binaryFile), std::istreambuf_iterator<char>())),
-        fileOffset
-    );
-
-    Decompiler::Arch decompilerArch;
-    if (arch == "x32" || arch == "x86") {
-        decompilerArch = Decompiler::Arch::x86;
-    } else if (arch == "x64" || arch == "x86_64") {
-        decompilerArch = Decompiler::Arch::x86_64;
-    } else if (arch == "armv7" || arch == "arm32") {
-        decompilerArch = Decompiler::Arch::armv7;
-    } else if (arch == "armv8" || arch == "arm64") {
-        decompilerArch = Decompiler::Arch::armv8;
-    } else {
-        std::cerr << "Invalid architecture: " << arch << std::endl;
-        return 1;
+    auto start = std::chrono::steady_clock::now();
+    std::mutex mutex;
+    std::condition_variable_any wakeup;
+    bool cancelled = false;
+    while (!stop.stop_requested()) {
+        if (interrupted && !cancelled) {
+            for (const auto& job : jobs) {
+                for (auto& task : job->tasks)
+                    task.stop.request_stop();
+            }
+            cancelled = true;
+            std::cerr << "\nInterrupted, cancelling the remaining functions" << std::endl;
+        }
+
+        if (showProgress) {
+            size_t doneSize = 0, doneTasks = 0;
+            for (const auto& job : jobs) {
+                doneSize += job->doneSize;
+                doneTasks += job->total;
+            }
+
+            std::string eta = "unknown";
+            if (doneSize > 0) {
+                auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                auto remaining = static_cast<size_t>(elapsed * static_cast<double>(totalSize - doneSize) / static_cast<double>(doneSize));
+                eta = std::format("{}m{:02}s", remaining / 60, remaining % 60);
+            }
+
+            double percent = totalSize ? static_cast<double>(doneSize) * 100.0 / static_cast<double>(totalSize) : 100.0;
+            std::cerr << std::format("\r{}/{} functions ({:.1f}% of code), ETA {}    ", doneTasks, totalTasks, percent, eta) << std::flush;
+        }
+
+        std::unique_lock lock(mutex);
+        wakeup.wait_for(lock, stop, std::chrono::milliseconds(500), [] { return false; });
     }
 
-    Decompiler decompiler(scanner, decompilerArch);
+    if (showProgress)
+        std::cerr << std::endl;
+}
 
-    std::ifstream bindingsFile(bindingsPath);
-    if (!bindingsFile.is_open()) {
-        std::cerr << "Failed to open bindings file: " << bindingsPath << std::endl;
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <binary-path> <bindings-path> <output> <file-offset> [arch=x64]" << std::endl;
+    std::cerr << "       " << program << " [options] --universal <binary-path> (<arch> <bindings-path> <output> <file-offset>)..." << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --max-stalled=<n>  give up on a function after n opcodes that didn't narrow down its matches (default: 32, 0 for no limit)" << std::endl;
+    std::cerr << "  --time-budget=<ms> give up on a function after searching it for this long" << std::endl;
+    std::cerr << "  --scan-budget=<n>  give up on a function after n full scans of the binary" << std::endl;
+    std::cerr << "  --no-progress      don't print the progress line" << std::endl;
+    std::cerr << "  --load=<mode>      map (default), populate (fault in every page up front) or hugepages (copy into huge pages)" << std::endl;
+    std::cerr << "Example: " << program << " GeometryDash.exe funcs.csv output.txt -0xC00 x32" << std::endl;
+    std::cerr << "Example: " << program << " --universal GeometryDash x86_64 funcs.csv output.txt -0x4000 arm64 funcs-m1.csv output-m1.txt 0x0" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string_view> args(argv, argv + argc);
+    MapperOptions options;
+    if (!parseOptions(args, options)) {
+        printUsage(argv[0]);
         return 1;
     }
 
-    std::ofstream outputFile(outputPath);
-    if (!outputFile.is_open()) {
-        std::cerr << "Failed to open output file: " << outputPath << std::endl;
+    argc = static_cast<int>(args.size());
+    bool universal = argc > 1 && args[1] == "--universal";
+    if (universal ? (argc < 7 || (argc - 3) % 4 != 0) : (argc != 5 && argc != 6)) {
+        printUsage(argv[0]);
         return 1;
     }
 
-    std::vector<SearchTask> tasks;
+    std::string binaryPath(universal ? args[2] : args[1]);
+    std::cout << "Binary path: " << binaryPath << std::endl;
 
-    // CSV format: <name>,<address>,<size>
-    std::string line;
-    std::getline(bindingsFile, line); // skip header
-    while (std::getline(bindingsFile, line)) {
-        auto commaPos = line.find(',');
-        if (commaPos == std::string::npos) {
-            std::cerr << "Invalid line in bindings file: " << line << std::endl;
+    MemoryStats memoryStats;
+    auto binary = MappedFile::open(binaryPath, options.loadMode);
+    if (!binary) {
+        std::cerr << "Failed to open binary file: " << binaryPath << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<MappingJob>> jobs;
+    if (universal) {
+        // the file is mapped once and every requested slice gets its own scanner over it,
+        // so patterns only have to be unique within their own architecture
+        auto slices = UniversalBinary::getSlices(binary->data());
+        if (slices.empty()) {
+            std::cerr << "Not a universal binary: " << binaryPath << std::endl;
             return 1;
         }
 
-        std::string name = line.substr(0, commaPos);
-        uintptr_t address = std::stoul(line.substr(commaPos + 1, line.find(',', commaPos + 1) - commaPos - 1), nullptr);
-        size_t size = std::stoul(line.substr(line.find(',', commaPos + 1) + 1), nullptr);
+        for (int i = 3; i < argc; i += 4) {
+            std::string_view arch = args[i];
+            auto decompilerArch = Decompiler::parseArch(arch);
+            auto slice = std::find_if(slices.begin(), slices.end(), [&](const UniversalSlice& s) {
+                return decompilerArch && Decompiler::parseArch(s.getArchName()) == decompilerArch;
+            });
+            if (slice == slices.end()) {
+                std::cerr << "No slice for architecture: " << arch << std::endl;
+                return 1;
+            }
 
-        tasks.emplace_back(name, address, size);
+            auto job = createJob(slice->getArchName(), binary, slice->offset, slice->size, arch, std::string(args[i + 1]), std::string(args[i + 2]), std::string(args[i + 3]));
+            if (!job) return 1;
+            jobs.push_back(std::move(job));
+        }
+    } else {
+        std::string arch(argc == 6 ? args[5] : "x64");
+        auto job = createJob(arch, binary, 0, binary->size(), arch, std::string(args[2]), std::string(args[3]), std::string(args[4]));
+        if (!job) return 1;
+        jobs.push_back(std::move(job));
     }
 
-    std::mutex outputMutex, consoleMutex;
-    auto writeToFile = [&](const std::string& text) {
-        std::lock_guard lock(outputMutex);
-        outputFile << text;
-    };
+    // started before indexing, so Ctrl+C and the progress line also cover it
+    std::signal(SIGINT, onInterrupt);
+    std::jthread monitor(monitorSearch, std::cref(jobs), options.progress);
 
-    auto writeToConsole = [&](const std::string& text, bool error = false) {
-        std::lock_guard lock(consoleMutex);
-        if (error) {
-            std::cerr << text;
-        } else {
-            std::cout << text;
+    ThreadPool pool;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // decompile every function once, so the ones without a unique prologue
+    // can still be found through the sites that reference them
+    for (auto& job : jobs) {
+        for (auto& task : job->tasks) {
+            pool.addTask([&job = *job, &task] {
+                if (interrupted) return;
+                std::vector<Opcode> opcodes;
+                job.decompiler.decompile(task.address, task.size, opcodes);
+                job.xrefs.addFunction(opcodes);
+                task.bodyHash = opcodes.empty() ? 0 : hashFunctionBody(opcodes);
+            });
         }
-    };
+    }
+    pool.runAllTasks();
 
-    std::atomic<int> count = 0, total = 0, failed = 0;
+    for (auto& job : jobs) {
+        if (!markDuplicates(*job)) return 1;
+    }
 
-    ThreadPool pool;
-    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-    for (auto& task : tasks) {
-        pool.addTask([&, task = std::ref(task)] {
-            auto signature = findSignature(task.get().name, task.get().address, task.get().size, scanner, decompiler);
-            if (signature.has_value()) {
-                auto o = std::format("0x{:X},{},{}\n", task.get().address, signature->name, signature->signature);
-                writeToFile(o);
-                // writeToConsole(o);
-                ++count;
-            } else {
-                // writeToConsole(std::format("{}: not found (size: {})\n", task.get().name, task.get().size), true);
-                ++failed;
-            }
+    for (auto& job : jobs) {
+        std::cout << std::format("[{}] Indexed {} references\n", job->label, job->xrefs.size());
+        std::cout << std::format("[{}] {} functions share their body with another one\n", job->label, job->duplicates);
+
+        for (auto& task : job->tasks) {
+            pool.addTask([&job = *job, &task, &options] {
+                SignatureOptions taskOptions = options.signature;
+                taskOptions.stopToken = task.stop.get_token();
+                // both searches share the budget, so the fallback only gets what the first one left
+                SearchBudget budget(taskOptions);
+
+                // the body of a duplicate matches at least twice, so only its references can be unique
+                std::optional<FunctionSignature> signature;
+                if (!task.duplicate)
+                    signature = findSignature(task.name, task.address, task.size, job.scanner, job.decompiler, budget);
+                if (!signature.has_value() && !budget.isExhausted()) {
+                    signature = findXrefSignature(task.name, task.address, job.scanner, job.decompiler, job.xrefs, budget);
+                    if (signature.has_value())
+                        ++job.viaXref;
+                }
+
+                if (signature.has_value()) {
+                    auto o = std::format("0x{:X},{},{}\n", task.address, signature->name, signature->signature);
+                    job.writeToFile(o);
+                    ++job.count;
+                } else if (task.stop.stop_requested()) {
+                    ++job.cancelled;
+                } else {
+                    ++job.failed;
+                }
 
-            ++total;
-            task.get().finished = true;
-        });
+                job.doneSize += task.size;
+                ++job.total;
+                task.finished = true;
+            });
+        }
     }
 
     pool.runAllTasks();
+    monitor.request_stop();
+    monitor.join();
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 
-    int count_ = count;
-    int total_ = total;
-    int failed_ = failed;
-    std::cout << std::format("Found {}/{} signatures ({} failed)\n", count_, total_, failed_);
+    for (auto& job : jobs) {
+        int count_ = job->count;
+        int total_ = job->total;
+        int failed_ = job->failed;
+        int viaXref_ = job->viaXref;
+        int cancelled_ = job->cancelled;
+        std::cout << std::format("[{}] Found {}/{} signatures ({} failed, {} cancelled, {} via xrefs)\n", job->label, count_, total_, failed_, cancelled_, viaXref_);
+    }
     std::cout << std::format("Time taken: {}ms\n", std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+    std::cout << memoryStats.summary() << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,62 @@
+#include "gram-index.hpp"
+#include "scanner.hpp"
+
+GramIndex::GramIndex(std::span<const uint8_t> data) : grams((1 << 24) / 64) {
+    for (auto byte : data)
+        ++byteCounts[byte];
+
+    if (data.size() < 3) return;
+    uint32_t gram = data[0] << 8 | data[1];
+    for (size_t i = 2; i < data.size(); i++) {
+        gram = (gram << 8 | data[i]) & 0xFFFFFF;
+        grams[gram >> 6] |= uint64_t(1) << (gram & 63);
+    }
+}
+
+uint64_t GramIndex::countMatches(uint8_t value, uint8_t mask) const {
+    if (mask == 0xFF)
+        return byteCounts[value];
+
+    uint64_t count = 0;
+    for (int byte = 0; byte < 256; byte++) {
+        if ((byte & mask) == value)
+            count += byteCounts[byte];
+    }
+    return count;
+}
+
+bool GramIndex::mayContain(const CompiledPattern& pattern) const {
+    // only runs of exact bytes can be looked up, masked tokens are checked on their own
+    size_t run = 0;
+    uint32_t gram = 0;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern.masks[i] != 0xFF) {
+            run = 0;
+            if (pattern.masks[i] != 0 && countMatches(pattern.bytes[i], pattern.masks[i]) == 0)
+                return false;
+            continue;
+        }
+
+        gram = (gram << 8 | pattern.bytes[i]) & 0xFFFFFF;
+        if (++run >= 3 ? !hasGram(gram) : byteCounts[pattern.bytes[i]] == 0)
+            return false;
+    }
+
+    return true;
+}
+
+size_t GramIndex::rarestToken(const CompiledPattern& pattern) const {
+    size_t rarest = pattern.anchor;
+    uint64_t rarestCount = UINT64_MAX;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern.masks[i] == 0) continue;
+
+        auto count = countMatches(pattern.bytes[i], pattern.masks[i]);
+        if (count < rarestCount) {
+            rarestCount = count;
+            rarest = i;
+        }
+    }
+
+    return rarest;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct CompiledPattern;
+
+/// Which 3 byte sequences occur in a binary, and how often every byte value does.
+/// Lets the scanner reject patterns that can't be in the binary without scanning it,
+/// and anchor the scan on the token that produces the fewest candidates.
+class GramIndex {
+public:
+    /// Below this size a full scan is faster than building the index
+    static constexpr size_t minBinarySize = 256 * 1024;
+
+    explicit GramIndex(std::span<const uint8_t> data);
+
+    /// False if some exact 3 byte run or single token of the pattern never occurs in the binary
+    [[nodiscard]] bool mayContain(const CompiledPattern& pattern) const;
+
+    /// Index of the token that matches the fewest bytes of the binary
+    [[nodiscard]] size_t rarestToken(const CompiledPattern& pattern) const;
+
+private:
+    [[nodiscard]] bool hasGram(uint32_t gram) const { return (grams[gram >> 6] >> (gram & 63)) & 1; }
+    /// Number of bytes in the binary that match `value` under `mask`
+    [[nodiscard]] uint64_t countMatches(uint8_t value, uint8_t mask) const;
+
+    /// one bit per possible 24 bit gram (2 MB)
+    std::vector<uint64_t> grams;
+    std::array<uint64_t, 256> byteCounts{};
+};
@@ -0,0 +1,179 @@
+#include "mapped-file.hpp"
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (mapping) UnmapViewOfFile(mapping);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+#else
+    if (mapping) munmap(mapping, mappingSize);
+#endif
+}
+
+std::optional<MappedFile::LoadMode> MappedFile::parseLoadMode(std::string_view name) {
+    if (name == "map")
+        return LoadMode::Map;
+    if (name == "populate")
+        return LoadMode::Populate;
+    if (name == "hugepages")
+        return LoadMode::HugePages;
+    return std::nullopt;
+}
+
+#ifndef __linux__
+/// Reads one byte of every page, so they are all resident before the first scan
+static void touchPages(std::span<const uint8_t> data) {
+    volatile uint8_t sink = 0;
+    for (size_t i = 0; i < data.size(); i += 4096)
+        sink = sink + data[i];
+}
+#endif
+
+#ifdef __linux__
+/// Spreads the pages of a range over all online NUMA nodes, so threads scanning it in parallel
+/// share the memory bandwidth of every node instead of all reading from the one that loaded it
+static void interleaveAcrossNodes(void* address, size_t size) {
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string ranges;
+    if (!std::getline(online, ranges))
+        return;
+
+    // e.g. "0-3" or "0,2-3"
+    unsigned long nodes = 0;
+    size_t count = 0;
+    for (size_t start = 0; start < ranges.size();) {
+        size_t end = ranges.find(',', start);
+        if (end == std::string::npos) end = ranges.size();
+        auto range = ranges.substr(start, end - start);
+        auto dash = range.find('-');
+        try {
+            unsigned long first = std::stoul(range.substr(0, dash));
+            unsigned long last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            for (unsigned long node = first; node <= last && node < sizeof(nodes) * 8; node++, count++)
+                nodes |= 1ul << node;
+        } catch (const std::exception&) {
+            return;
+        }
+        start = end + 1;
+    }
+
+    // a failure only means the pages stay where they are first touched
+    if (count > 1)
+        syscall(SYS_mbind, address, size, MPOL_INTERLEAVE, &nodes, sizeof(nodes) * 8, 0);
+}
+
+/// Copies the file into anonymous memory aligned to (and advised for) 2 MB pages
+static void* loadHugePages(int fd, size_t size, size_t& mappedSize) {
+    constexpr size_t hugePageSize = 2 * 1024 * 1024;
+    size_t alignedSize = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+
+    // over-allocate and trim, mmap only guarantees normal page alignment
+    size_t reserved = alignedSize + hugePageSize;
+    void* region = mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+        return nullptr;
+
+    auto begin = reinterpret_cast<uintptr_t>(region);
+    auto aligned = (begin + hugePageSize - 1) / hugePageSize * hugePageSize;
+    if (aligned > begin)
+        munmap(region, aligned - begin);
+    if (begin + reserved > aligned + alignedSize)
+        munmap(reinterpret_cast<void*>(aligned + alignedSize), begin + reserved - aligned - alignedSize);
+
+    auto address = reinterpret_cast<uint8_t*>(aligned);
+    madvise(address, alignedSize, MADV_HUGEPAGE);
+    interleaveAcrossNodes(address, alignedSize);
+
+    for (size_t done = 0; done < size;) {
+        ssize_t read = pread(fd, address + done, size - done, static_cast<off_t>(done));
+        if (read <= 0) {
+            munmap(address, alignedSize);
+            return nullptr;
+        }
+        done += static_cast<size_t>(read);
+    }
+
+    mprotect(address, alignedSize, PROT_READ);
+    mappedSize = alignedSize;
+    return address;
+}
+#endif
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path, LoadMode mode) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    size_t fileSize = 0;
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle != INVALID_HANDLE_VALUE) {
+        file->fileHandle = handle;
+
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(handle, &size) && size.QuadPart > 0) {
+            file->mappingHandle = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (file->mappingHandle)
+                file->mapping = MapViewOfFile(file->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+            file->mappingSize = static_cast<size_t>(size.QuadPart);
+            fileSize = file->mappingSize;
+        }
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd != -1) {
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            fileSize = static_cast<size_t>(st.st_size);
+#ifdef __linux__
+            if (mode == LoadMode::HugePages)
+                file->mapping = loadHugePages(fd, fileSize, file->mappingSize);
+            // MAP_POPULATE also reads ahead the whole file in one go
+            int flags = MAP_PRIVATE | (mode != LoadMode::Map ? MAP_POPULATE : 0);
+#else
+            int flags = MAP_PRIVATE;
+#endif
+            if (!file->mapping) {
+                void* address = mmap(nullptr, fileSize, PROT_READ, flags, fd, 0);
+                if (address != MAP_FAILED) {
+                    file->mapping = address;
+                    file->mappingSize = fileSize;
+                }
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    if (file->mapping) {
+        file->view = { static_cast<const uint8_t*>(file->mapping), fileSize };
+#ifndef __linux__
+        if (mode != LoadMode::Map)
+            touchPages(file->view);
+#endif
+        return file;
+    }
+
+    // mapping failed, read the whole thing instead
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open())
+        return nullptr;
+
+    file->fallback.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    file->view = file->fallback;
+    return file;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Read-only view of a file on disk.
+/// The file is memory-mapped when the platform allows it, so loading a big binary doesn't copy it up front
+/// and several scanners (or universal binary slices) can share the same pages.
+class MappedFile {
+public:
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// How the file is brought into memory.
+    /// Scans sweep the whole binary over and over, so paying for page faults up front (and using fewer TLB entries) can be worth it
+    enum class LoadMode {
+        /// pages are faulted in on first access
+        Map,
+        /// every page is faulted in when the file is opened
+        Populate,
+        /// the file is copied into memory backed by transparent huge pages, interleaved across NUMA nodes.
+        /// Linux only, elsewhere this is the same as Populate
+        HugePages,
+    };
+
+    /// Returns nullptr if the file couldn't be opened
+    [[nodiscard]] static std::shared_ptr<MappedFile> open(const std::string& path, LoadMode mode = LoadMode::Map);
+
+    /// Parses "map", "populate" or "hugepages"
+    [[nodiscard]] static std::optional<LoadMode> parseLoadMode(std::string_view name);
+
+    [[nodiscard]] std::span<const uint8_t> data() const { return view; }
+    [[nodiscard]] size_t size() const { return view.size(); }
+
+private:
+    MappedFile() = default;
+
+    std::span<const uint8_t> view;
+    /// used when mapping isn't possible (e.g. empty files)
+    std::vector<uint8_t> fallback;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,134 @@
+#include "reference.hpp"
+#include <cstring>
+
+static std::string_view kindToString(ReferenceKind kind) {
+    switch (kind) {
+        case ReferenceKind::Rel32: return "rel32";
+        case ReferenceKind::Arm64Branch: return "arm64-branch";
+        case ReferenceKind::Arm64AdrpAdd: return "arm64-adrp-add";
+    }
+    return "";
+}
+
+static std::optional<ReferenceKind> kindFromString(std::string_view kind) {
+    if (kind == "rel32") return ReferenceKind::Rel32;
+    if (kind == "arm64-branch") return ReferenceKind::Arm64Branch;
+    if (kind == "arm64-adrp-add") return ReferenceKind::Arm64AdrpAdd;
+    return std::nullopt;
+}
+
+static std::vector<std::string_view> splitFields(std::string_view str, char separator) {
+    std::vector<std::string_view> fields;
+    size_t start = 0;
+    size_t end = str.find(separator);
+    while (end != std::string_view::npos) {
+        fields.push_back(str.substr(start, end - start));
+        start = end + 1;
+        end = str.find(separator, start);
+    }
+    fields.push_back(str.substr(start));
+    return fields;
+}
+
+std::string ReferenceSignature::toString() const {
+    return std::format(
+        "{}{}:{:X}:{:X}:{:X};{}",
+        prefix, kindToString(kind), instructionOffset, operandOffset, instructionLength,
+        PatternToken::fromPatternTokens(pattern)
+    );
+}
+
+std::optional<ReferenceSignature> ReferenceSignature::fromString(std::string_view signature) {
+    if (!isReference(signature)) return std::nullopt;
+    signature.remove_prefix(prefix.size());
+
+    auto separator = signature.find(';');
+    if (separator == std::string_view::npos) return std::nullopt;
+    // <kind>:<instruction offset>:<operand offset>:<instruction length>
+    auto fields = splitFields(signature.substr(0, separator), ':');
+    if (fields.size() != 4)
+        return std::nullopt;
+
+    ReferenceSignature result;
+    auto kind = kindFromString(fields[0]);
+    if (!kind) return std::nullopt;
+    result.kind = *kind;
+
+    try {
+        result.instructionOffset = std::stoul(std::string(fields[1]), nullptr, 16);
+        result.operandOffset = std::stoul(std::string(fields[2]), nullptr, 16);
+        result.instructionLength = std::stoul(std::string(fields[3]), nullptr, 16);
+        result.pattern = PatternToken::fromString(signature.substr(separator + 1));
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+static uint32_t readU32(std::span<const uint8_t> bytes, size_t offset) {
+    uint32_t value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(value));
+    return value;
+}
+
+std::optional<uintptr_t> ReferenceSignature::resolve(const Scanner& scanner, uintptr_t match) const {
+    uintptr_t address = match + instructionOffset;
+    switch (kind) {
+        case ReferenceKind::Rel32: {
+            auto bytes = scanner.getMatchBytes(address, instructionLength);
+            if (bytes.size() != instructionLength || operandOffset + 4 > instructionLength)
+                return std::nullopt;
+            auto rel = static_cast<int32_t>(readU32(bytes, operandOffset));
+            return address + instructionLength + static_cast<intptr_t>(rel);
+        }
+        case ReferenceKind::Arm64Branch: {
+            auto bytes = scanner.getMatchBytes(address, 4);
+            if (bytes.size() != 4) return std::nullopt;
+            return decodeArm64Branch(address, readU32(bytes, 0));
+        }
+        case ReferenceKind::Arm64AdrpAdd: {
+            auto bytes = scanner.getMatchBytes(address, operandOffset + 4);
+            if (bytes.size() != operandOffset + 4u) return std::nullopt;
+            return decodeArm64AdrpAdd(address, readU32(bytes, 0), readU32(bytes, operandOffset));
+        }
+    }
+    return std::nullopt;
+}
+
+/// NOTE:
+/// Encodings below are taken from the ARMv8 reference manual, instructions are little endian words
+
+std::optional<uintptr_t> ReferenceSignature::decodeArm64Branch(uintptr_t address, uint32_t instruction) {
+    // B  0b000101 imm26
+    // BL 0b100101 imm26
+    if ((instruction & 0x7C000000) != 0x14000000)
+        return std::nullopt;
+
+    // sign-extend imm26 and scale to bytes
+    auto imm = static_cast<int64_t>(static_cast<int32_t>(instruction << 6) >> 6) * 4;
+    return address + imm;
+}
+
+std::optional<uintptr_t> ReferenceSignature::decodeArm64AdrpAdd(uintptr_t address, uint32_t adrp, uint32_t add) {
+    // ADRP       0b1 immlo(2) 0b10000 immhi(19) Rd(5)
+    // ADD(imm)   0b1001000100 sh imm12 Rn(5) Rd(5)
+    if ((adrp & 0x9F000000) != 0x90000000 || (add & 0xFF800000) != 0x91000000)
+        return std::nullopt;
+
+    // add has to use the register adrp wrote to
+    if ((adrp & 0x1F) != ((add >> 5) & 0x1F))
+        return std::nullopt;
+
+    uint32_t immlo = (adrp >> 29) & 0b11;
+    uint32_t immhi = (adrp >> 5) & 0x7FFFF;
+    // sign-extend the 21-bit page offset
+    auto pages = static_cast<int64_t>(static_cast<int32_t>(((immhi << 2) | immlo) << 11) >> 11);
+    uintptr_t page = (address & ~static_cast<uintptr_t>(0xFFF)) + pages * 0x1000;
+
+    uintptr_t offset = (add >> 10) & 0xFFF;
+    if ((add >> 22) & 1)
+        offset <<= 12;
+
+    return page + offset;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+#include "scanner.hpp"
+
+/// Kind of operand a reference signature follows to reach its target
+enum class ReferenceKind : uint8_t {
+    /// x86 call/jmp rel32 or RIP-relative disp32 (relative to the next instruction)
+    Rel32,
+    /// ARM64 b/bl with a 26-bit word offset
+    Arm64Branch,
+    /// ARM64 adrp followed by an add with a 12-bit page offset
+    Arm64AdrpAdd,
+};
+
+/// Signature that finds a function through a unique site referencing it ("signature via caller").
+/// Serialized as `xref:<kind>:<instruction offset>:<operand offset>:<instruction length>;<pattern>`
+struct ReferenceSignature {
+    std::vector<PatternToken> pattern;
+    /// Offset of the referencing instruction inside the pattern
+    size_t instructionOffset = 0;
+    ReferenceKind kind = ReferenceKind::Rel32;
+    /// Rel32: offset of the operand inside the instruction
+    /// Arm64AdrpAdd: distance from the adrp to the add
+    uint8_t operandOffset = 0;
+    /// Rel32: length of the referencing instruction
+    uint8_t instructionLength = 0;
+
+    static constexpr std::string_view prefix = "xref:";
+
+    [[nodiscard]] static bool isReference(std::string_view signature) {
+        return signature.starts_with(prefix);
+    }
+
+    [[nodiscard]] std::string toString() const;
+    [[nodiscard]] static std::optional<ReferenceSignature> fromString(std::string_view signature);
+
+    /// Follows the reference at a pattern match (an address returned by Scanner::find)
+    [[nodiscard]] std::optional<uintptr_t> resolve(const Scanner& scanner, uintptr_t match) const;
+
+    [[nodiscard]] static std::optional<uintptr_t> decodeArm64Branch(uintptr_t address, uint32_t instruction);
+    [[nodiscard]] static std::optional<uintptr_t> decodeArm64AdrpAdd(uintptr_t address, uint32_t adrp, uint32_t add);
+};
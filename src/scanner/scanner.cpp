@@ -1,7 +1,20 @@
 #include "scanner.hpp"
+#include "gram-index.hpp"
+#include <bit>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SCANNER_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SCANNER_NEON
+#endif
+
 std::string PatternToken::toString() const {
     if (isWildcard)
         return "?";
@@ -58,49 +71,307 @@ char peek(std::string_view pattern, size_t i) {
     return i < pattern.size() ? pattern[i] : '\0';
 }
 
+static bool isHexDigit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static uint8_t hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+static uint8_t parseHexByte(std::string_view pattern, size_t i) {
+    if (!isHexDigit(peek(pattern, i)) || !isHexDigit(peek(pattern, i + 1)))
+        throw std::invalid_argument(std::format("Invalid byte at {} in pattern: {}", i, pattern));
+    return hexDigit(pattern[i]) << 4 | hexDigit(pattern[i + 1]);
+}
+
 std::vector<PatternToken> PatternToken::fromString(std::string_view pattern) {
+    // Token syntax:
+    //   ?      wildcard
+    //   8B     exact byte
+    //   8B&FC  byte with a bit mask
+    //   4?     high nibble only (same as 40&F0)
+    //   ?8     low nibble only (same as 08&0F)
+    // Malformed tokens throw std::invalid_argument
     std::vector<PatternToken> tokens;
-    for (size_t i = 0; i < pattern.size(); i++) {
+    size_t i = 0;
+    while (true) {
         swallowWhitespace(pattern, i);
+        if (i >= pattern.size())
+            break;
 
         if (pattern[i] == '?') {
-            tokens.push_back(PatternToken::wildcard());
+            if (isHexDigit(peek(pattern, i + 1))) {
+                tokens.push_back(PatternToken::fromByteMask(hexDigit(pattern[i + 1]), 0x0F));
+                i += 2;
+            } else {
+                tokens.push_back(PatternToken::wildcard());
+                i++;
+            }
+        } else if (peek(pattern, i + 1) == '?') {
+            if (!isHexDigit(pattern[i]))
+                throw std::invalid_argument(std::format("Invalid byte at {} in pattern: {}", i, pattern));
+            tokens.push_back(PatternToken::fromByteMask(hexDigit(pattern[i]) << 4, 0xF0));
+            i += 2;
         } else {
-            uint8_t byte = std::stoi(std::string(pattern.substr(i, 2)), nullptr, 16);
-            // check if the next character is an ampersand
-            if (peek(pattern, i + 2) == '&') {
-                uint8_t mask = std::stoi(std::string(pattern.substr(i + 3, 2)), nullptr, 16);
-                tokens.push_back(PatternToken::fromByteMask(byte, mask));
-                i += 5;
+            uint8_t byte = parseHexByte(pattern, i);
+            i += 2;
+            if (peek(pattern, i) == '&') {
+                tokens.push_back(PatternToken::fromByteMask(byte, parseHexByte(pattern, i + 1)));
+                i += 3;
             } else {
                 tokens.push_back(PatternToken::fromByte(byte));
-                i++;
             }
         }
     }
 
-    // make sure we got all the tokens
-    // std::cout << std::format("o: {}\nn: {}\n", pattern, fromPatternTokens(tokens));
+    return tokens;
+}
+
+CompiledPattern::CompiledPattern(const std::vector<PatternToken>& tokens) {
+    bytes.reserve(tokens.size());
+    masks.reserve(tokens.size());
+
+    int anchorBits = -1;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        uint8_t mask = tokens[i].isWildcard ? 0 : tokens[i].mask;
+        bytes.push_back(tokens[i].byte & mask);
+        masks.push_back(mask);
+
+        // the more bits are fixed, the fewer false candidates the anchor produces
+        int bits = std::popcount(mask);
+        if (bits > anchorBits) {
+            anchorBits = bits;
+            anchor = i;
+        }
+    }
+}
+
+bool CompiledPattern::matchesAt(const uint8_t* data) const {
+    size_t i = 0;
+
+    // compare 8 bytes at a time, masks make wildcards and bit masks free
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t value, mask, expected;
+        std::memcpy(&value, data + i, 8);
+        std::memcpy(&mask, masks.data() + i, 8);
+        std::memcpy(&expected, bytes.data() + i, 8);
+        if ((value & mask) != expected)
+            return false;
+    }
+
+    for (; i < bytes.size(); i++) {
+        if ((data[i] & masks[i]) != bytes[i])
+            return false;
+    }
 
+    return true;
+}
+
+/// Returns a bit for each of the 16 bytes at `data` that matches `value` under `mask`
+static uint32_t matchBlock(const uint8_t* data, uint8_t value, uint8_t mask) {
+#if defined(SCANNER_SSE2)
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i masked = _mm_and_si128(block, _mm_set1_epi8(static_cast<char>(mask)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(masked, _mm_set1_epi8(static_cast<char>(value)))));
+#elif defined(SCANNER_NEON)
+    uint8x16_t masked = vandq_u8(vld1q_u8(data), vdupq_n_u8(mask));
+    uint8x16_t equal = vceqq_u8(masked, vdupq_n_u8(value));
+    // narrow every byte to a nibble, NEON has no movemask
+    uint64_t nibbles = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+    if (nibbles == 0) return 0;
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++) {
+        if ((nibbles >> (i * 4)) & 1)
+            bits |= 1u << i;
+    }
+    return bits;
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++) {
+        if ((data[i] & mask) == value)
+            bits |= 1u << i;
+    }
+    return bits;
+#endif
+}
+
+#ifdef SIGSCAN_VERIFY_FAST_PATHS
+/// Turns a compiled pattern back into tokens for the reference loop
+static std::vector<PatternToken> toTokens(const CompiledPattern& pattern) {
+    std::vector<PatternToken> tokens;
+    tokens.reserve(pattern.size());
+    for (size_t i = 0; i < pattern.size(); i++)
+        tokens.push_back(PatternToken::fromByteMask(pattern.bytes[i], pattern.masks[i]));
     return tokens;
 }
 
+/// Aborts if a fast path returned anything other than `expected`
+static void verifyMatches(const std::vector<PatternToken>& tokens, std::span<const uintptr_t> matches, std::span<const uintptr_t> expected, std::string_view path) {
+    if (std::ranges::equal(matches, expected))
+        return;
+
+    std::cerr << std::format(
+        "{} returned {} matches instead of {} for pattern: {}\n",
+        path, matches.size(), expected.size(), PatternToken::fromPatternTokens(tokens)
+    );
+    std::abort();
+}
+
+/// Aborts if the fast scan returned anything other than the reference loop
+static void verifyMatches(const Scanner& scanner, const std::vector<PatternToken>& tokens, std::span<const uintptr_t> matches, std::string_view path) {
+    std::vector<uintptr_t> expected;
+    scanner.findReference(tokens, expected);
+    verifyMatches(tokens, matches, expected, path);
+}
+#endif
+
 bool Scanner::find(const std::vector<PatternToken> &tokens, std::vector<uintptr_t> &results) const {
-    for (size_t i = 0; i < binary.size(); i++) {
-        bool found = true;
-        for (size_t j = 0; j < tokens.size(); j++) {
-            if (i + j >= binary.size() || tokens[j] != binary[i + j]) {
-                found = false;
-                break;
+    return find(CompiledPattern(tokens), results);
+}
+
+const GramIndex* Scanner::getGramIndex() const {
+    if (binary.size() < GramIndex::minBinarySize)
+        return nullptr;
+
+    std::call_once(gramIndexFlag, [this] {
+        gramIndex = std::make_shared<GramIndex>(binary);
+    });
+    return gramIndex.get();
+}
+
+std::optional<size_t> Scanner::chooseAnchor(const CompiledPattern &pattern) const {
+    auto index = getGramIndex();
+    if (!index)
+        return pattern.anchor;
+
+    // patterns missing from a newer binary are rejected here instead of after a full scan
+    if (!index->mayContain(pattern))
+        return std::nullopt;
+    return index->rarestToken(pattern);
+}
+
+bool Scanner::find(const CompiledPattern &pattern, std::vector<uintptr_t> &results) const {
+#ifdef SIGSCAN_VERIFY_FAST_PATHS
+    size_t first = results.size();
+#endif
+
+    if (auto anchor = chooseAnchor(pattern))
+        findInRange(pattern, *anchor, 0, binary.size(), results);
+
+#ifdef SIGSCAN_VERIFY_FAST_PATHS
+    verifyMatches(*this, toTokens(pattern), std::span(results).subspan(first), "find");
+#endif
+    return !results.empty();
+}
+
+void Scanner::findInRange(const CompiledPattern &pattern, size_t anchor, size_t begin, size_t end, std::vector<uintptr_t> &results) const {
+    size_t length = pattern.size();
+    if (length > binary.size()) return;
+
+    // only positions where the whole pattern fits, aligned to the scanner alignment
+    end = std::min(end, binary.size() - std::max<size_t>(length, 1) + 1);
+    begin = (begin + alignment - 1) / alignment * alignment;
+
+    const uint8_t* data = binary.data();
+    uint8_t anchorByte = length ? pattern.bytes[anchor] : 0;
+    uint8_t anchorMask = length ? pattern.masks[anchor] : 0;
+
+    size_t i = begin;
+
+    // search 16 anchor candidates at once, and only verify the full pattern where the anchor matched.
+    // the loop steps by 16, so for power of two alignments the aligned positions always map to the same bits
+    if (anchorMask != 0 && alignment <= 16 && std::has_single_bit(alignment)) {
+        uint32_t alignedBits = 0;
+        for (size_t bit = 0; bit < 16; bit += alignment)
+            alignedBits |= 1u << bit;
+
+        for (; i < end && i + anchor + 16 <= binary.size(); i += 16) {
+            uint32_t bits = matchBlock(data + i + anchor, anchorByte, anchorMask) & alignedBits;
+            if (end - i < 16)
+                bits &= (1u << (end - i)) - 1;
+
+            while (bits) {
+                size_t position = i + std::countr_zero(bits);
+                bits &= bits - 1;
+                if (pattern.matchesAt(data + position))
+                    results.push_back(position + baseAddress);
             }
         }
+    }
+
+    for (; i < end; i += alignment) {
+        if ((data[i + anchor] & anchorMask) == anchorByte && pattern.matchesAt(data + i))
+            results.push_back(i + baseAddress);
+    }
+}
 
-        if (found) {
+void Scanner::findReference(const std::vector<PatternToken> &tokens, std::vector<uintptr_t> &results) const {
+    // an empty pattern matches at every offset inside the binary, same as in findInRange
+    size_t length = std::max<size_t>(tokens.size(), 1);
+    for (size_t i = 0; i + length <= binary.size(); i += alignment) {
+        bool matches = true;
+        for (size_t j = 0; j < tokens.size() && matches; j++)
+            matches = tokens[j].matches(binary[i + j]);
+        if (matches)
             results.push_back(i + baseAddress);
+    }
+}
+
+void Scanner::filter(const CompiledPattern &pattern, std::vector<uintptr_t> &matches) const {
+#ifdef SIGSCAN_VERIFY_FAST_PATHS
+    // the matches that the reference loop also finds, in their original order
+    auto tokens = toTokens(pattern);
+    std::vector<uintptr_t> reference, expected;
+    findReference(tokens, reference);
+    // a negative base address wraps around, so the reference isn't always in ascending order
+    std::ranges::sort(reference);
+    std::ranges::copy_if(matches, std::back_inserter(expected), [&](uintptr_t match) {
+        return std::ranges::binary_search(reference, match);
+    });
+#endif
+
+    std::erase_if(matches, [&](uintptr_t match) {
+        uintptr_t start = match - baseAddress;
+        if (start >= binary.size() || binary.size() - start < pattern.size())
+            return true;
+        return !pattern.matchesAt(binary.data() + start);
+    });
+
+#ifdef SIGSCAN_VERIFY_FAST_PATHS
+    verifyMatches(tokens, matches, expected, "filter");
+#endif
+}
+
+void Scanner::findBatch(const std::vector<std::vector<PatternToken>> &patterns, std::vector<std::vector<uintptr_t>> &results) const {
+    // small enough to stay in L2 while every pattern is run over it
+    constexpr size_t chunkSize = 256 * 1024;
+
+    // patterns that can't be in the binary are left out of the sweep entirely
+    std::vector<CompiledPattern> compiled;
+    std::vector<std::pair<size_t, size_t>> active; // (pattern index, anchor)
+    compiled.reserve(patterns.size());
+    for (const auto& pattern : patterns) {
+        compiled.emplace_back(pattern);
+        if (auto anchor = chooseAnchor(compiled.back()))
+            active.emplace_back(compiled.size() - 1, *anchor);
+    }
+
+    results.assign(patterns.size(), {});
+    for (size_t begin = 0; begin < binary.size(); begin += chunkSize) {
+        size_t end = std::min(begin + chunkSize, binary.size());
+        for (auto [i, anchor] : active) {
+            findInRange(compiled[i], anchor, begin, end, results[i]);
         }
     }
 
-    return !results.empty();
+#ifdef SIGSCAN_VERIFY_FAST_PATHS
+    for (size_t i = 0; i < patterns.size(); i++)
+        verifyMatches(*this, patterns[i], results[i], "findBatch");
+#endif
 }
 
 bool Scanner::find(std::string_view pattern, std::vector<uintptr_t> &results) const {
@@ -120,12 +391,19 @@ bool Scanner::find(std::string_view pattern, uintptr_t &result) const {
 }
 
 std::string Scanner::generateUniquePattern(uintptr_t address, size_t maxLength) const {
+    return generateUniquePatternAt(address + baseAddress, maxLength);
+}
+
+std::string Scanner::generateUniqueMatchPattern(uintptr_t match, size_t maxLength) const {
+    return generateUniquePatternAt(match - baseAddress, maxLength);
+}
+
+std::string Scanner::generateUniquePatternAt(size_t index, size_t maxLength) const {
     // Add bytes to the pattern until we reach the maximum length or only one address is found
     std::vector<PatternToken> pattern;
-    address += baseAddress;
     bool found = false;
-    for (size_t i = 0; i < maxLength; i++) {
-        pattern.push_back(PatternToken::fromByte(binary[address + i]));
+    for (size_t i = 0; i < maxLength && index + i < binary.size(); i++) {
+        pattern.push_back(PatternToken::fromByte(binary[index + i]));
         std::vector<uintptr_t> results;
         if (find(pattern, results) && results.size() == 1) {
             found = true;
@@ -144,11 +422,20 @@ std::string Scanner::generateUniquePattern(uintptr_t address, size_t maxLength)
     return patternString;
 }
 
-std::span<uint8_t> Scanner::getSubArray(uintptr_t address, size_t length) const {
+std::span<const uint8_t> Scanner::getSubArray(uintptr_t address, size_t length) const {
     uintptr_t start = address + baseAddress;
     if (start >= binary.size()) return {};
     return {
-        const_cast<uint8_t*>(binary.data()) + start,
+        binary.data() + start,
+        std::min(length, binary.size() - start)
+    };
+}
+
+std::span<const uint8_t> Scanner::getMatchBytes(uintptr_t match, size_t length) const {
+    uintptr_t start = match - baseAddress;
+    if (start >= binary.size()) return {};
+    return {
+        binary.data() + start,
         std::min(length, binary.size() - start)
     };
 }
@@ -1,10 +1,17 @@
 #pragma once
+#include <algorithm>
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <utility>
 #include <string_view>
 #include <format>
 #include <span>
+#include "mapped-file.hpp"
+
+class GramIndex;
 
 struct PatternToken {
     bool isWildcard;
@@ -50,20 +57,90 @@ struct PatternToken {
     }
 };
 
+/// Pattern prepared for scanning: every token is turned into a (masked byte, mask) pair,
+/// and the token with the most fixed bits is picked as the anchor the scan loop searches for first
+struct CompiledPattern {
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> masks;
+    size_t anchor = 0;
+
+    explicit CompiledPattern(const std::vector<PatternToken>& tokens);
+
+    [[nodiscard]] size_t size() const { return bytes.size(); }
+
+    /// Checks the whole pattern at `data`, which must have at least size() bytes
+    [[nodiscard]] bool matchesAt(const uint8_t* data) const;
+};
+
 class Scanner {
 public:
     Scanner(std::vector<uint8_t> binary, intptr_t baseAddress)
-        : binary(std::move(binary)), baseAddress(baseAddress) {}
+        : storage(std::move(binary)), binary(storage), baseAddress(baseAddress) {}
+
+    /// Scans (a part of) a mapped file without copying it
+    Scanner(std::shared_ptr<const MappedFile> file, intptr_t baseAddress, size_t offset = 0, size_t size = SIZE_MAX)
+        : file(std::move(file)), baseAddress(baseAddress) {
+        auto data = this->file->data();
+        offset = std::min(offset, data.size());
+        binary = data.subspan(offset, std::min(size, data.size() - offset));
+    }
+
+    /// Scans memory owned by the caller, which has to outlive the scanner and must not change while it's used
+    Scanner(std::span<const uint8_t> view, intptr_t baseAddress)
+        : binary(view), baseAddress(baseAddress) {}
+
+    Scanner(const Scanner&) = delete;
+    Scanner& operator=(const Scanner&) = delete;
 
     bool find(const std::vector<PatternToken> &tokens, std::vector<uintptr_t>& results) const;
+    bool find(const CompiledPattern& pattern, std::vector<uintptr_t>& results) const;
     bool find(std::string_view pattern, std::vector<uintptr_t>& results) const;
     bool find(std::string_view pattern, uintptr_t& result) const;
 
-    [[nodiscard]] std::span<uint8_t> getSubArray(uintptr_t address, size_t length) const;
+    /// Plain token by token scan. Slow, but obviously correct, so every faster path is checked against it
+    void findReference(const std::vector<PatternToken>& tokens, std::vector<uintptr_t>& results) const;
+
+    /// Keeps only the matches (addresses returned by find()) where the pattern also matches.
+    /// Extending a pattern can only remove matches, so this is much cheaper than scanning again
+    void filter(const CompiledPattern& pattern, std::vector<uintptr_t>& matches) const;
+
+    /// Scans for many patterns in a single sweep over the binary.
+    /// The binary is processed in cache-sized chunks, so every byte is fetched from memory once per batch
+    /// instead of once per pattern. `results[i]` receives the matches of `patterns[i]`.
+    void findBatch(const std::vector<std::vector<PatternToken>>& patterns, std::vector<std::vector<uintptr_t>>& results) const;
+
+    [[nodiscard]] std::span<const uint8_t> getSubArray(uintptr_t address, size_t length) const;
+    /// Same as getSubArray, but takes an address returned by find()
+    [[nodiscard]] std::span<const uint8_t> getMatchBytes(uintptr_t match, size_t length) const;
 
     [[nodiscard]] std::string generateUniquePattern(uintptr_t address, size_t maxLength) const;
+    /// Same as generateUniquePattern, but takes an address returned by find()
+    [[nodiscard]] std::string generateUniqueMatchPattern(uintptr_t match, size_t maxLength) const;
+
+    [[nodiscard]] size_t size() const { return binary.size(); }
+
+    /// Only try matches at offsets that are a multiple of `alignment` (e.g. 4 for ARM64 instructions)
+    void setAlignment(size_t value) { alignment = std::max<size_t>(value, 1); }
+    [[nodiscard]] size_t getAlignment() const { return alignment; }
 
 private:
-    std::vector<uint8_t> binary;
+    /// Appends matches starting in [begin, end) to results, searching for the token at `anchor` first
+    void findInRange(const CompiledPattern& pattern, size_t anchor, size_t begin, size_t end, std::vector<uintptr_t>& results) const;
+
+    /// Grows a pattern from the byte at `index` of the binary until it only matches once, returns "" if it never does
+    [[nodiscard]] std::string generateUniquePatternAt(size_t index, size_t maxLength) const;
+
+    /// Picks the token to search for first, or nothing if the pattern can't be in the binary at all
+    [[nodiscard]] std::optional<size_t> chooseAnchor(const CompiledPattern& pattern) const;
+    /// Built on first use, nullptr for binaries too small to benefit from it
+    [[nodiscard]] const GramIndex* getGramIndex() const;
+
+    std::vector<uint8_t> storage;
+    std::shared_ptr<const MappedFile> file;
+    std::span<const uint8_t> binary;
     intptr_t baseAddress;
+    size_t alignment = 1;
+
+    mutable std::once_flag gramIndexFlag;
+    mutable std::shared_ptr<const GramIndex> gramIndex;
 };
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "universal.hpp"
+#include <format>
+
+// struct fat_header {
+//     uint32_t magic;      /* FAT_MAGIC or FAT_MAGIC_64 */
+//     uint32_t nfat_arch;  /* number of structs that follow */
+// };
+//
+// struct fat_arch {                  struct fat_arch_64 {
+//     cpu_type_t    cputype;             cpu_type_t    cputype;
+//     cpu_subtype_t cpusubtype;          cpu_subtype_t cpusubtype;
+//     uint32_t      offset;              uint64_t      offset;
+//     uint32_t      size;                uint64_t      size;
+//     uint32_t      align;               uint32_t      align;
+// };                                     uint32_t      reserved;
+//                                    };
+// Everything in the fat header is big endian.
+
+constexpr uint32_t FAT_MAGIC = 0xCAFEBABE;
+constexpr uint32_t FAT_MAGIC_64 = 0xCAFEBABF;
+
+// java class files share the magic, but never have this few "architectures"
+constexpr uint32_t MAX_FAT_ARCHS = 0x20;
+
+static uint32_t readBE32(std::span<const uint8_t> data, size_t offset) {
+    return (uint32_t(data[offset]) << 24) | (uint32_t(data[offset + 1]) << 16) |
+           (uint32_t(data[offset + 2]) << 8) | uint32_t(data[offset + 3]);
+}
+
+static uint64_t readBE64(std::span<const uint8_t> data, size_t offset) {
+    return (uint64_t(readBE32(data, offset)) << 32) | readBE32(data, offset + 4);
+}
+
+std::string UniversalSlice::getArchName() const {
+    switch (cpuType) {
+        case CPU_TYPE_X86: return "x86";
+        case CPU_TYPE_X86_64: return "x86_64";
+        case CPU_TYPE_ARM: return "armv7";
+        case CPU_TYPE_ARM64: return "arm64";
+        default: return std::format("unknown({:X})", cpuType);
+    }
+}
+
+std::vector<UniversalSlice> UniversalBinary::getSlices(std::span<const uint8_t> data) {
+    if (data.size() < 8) return {};
+
+    uint32_t magic = readBE32(data, 0);
+    if (magic != FAT_MAGIC && magic != FAT_MAGIC_64) return {};
+
+    bool is64 = magic == FAT_MAGIC_64;
+    uint32_t count = readBE32(data, 4);
+    size_t entrySize = is64 ? 32 : 20;
+    if (count > MAX_FAT_ARCHS || 8 + count * entrySize > data.size()) return {};
+
+    std::vector<UniversalSlice> slices;
+    for (uint32_t i = 0; i < count; i++) {
+        size_t entry = 8 + i * entrySize;
+
+        UniversalSlice slice;
+        slice.cpuType = readBE32(data, entry);
+        slice.offset = is64 ? readBE64(data, entry + 8) : readBE32(data, entry + 8);
+        slice.size = is64 ? readBE64(data, entry + 16) : readBE32(data, entry + 12);
+
+        // skip slices pointing outside the file
+        if (slice.offset > data.size() || slice.size > data.size() - slice.offset)
+            continue;
+
+        slices.push_back(slice);
+    }
+
+    return slices;
+}
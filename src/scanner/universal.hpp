@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+/// Architecture slice of a universal (fat) Mach-O binary
+struct UniversalSlice {
+    uint32_t cpuType;
+    uint64_t offset;
+    uint64_t size;
+
+    static constexpr uint32_t CPU_TYPE_X86 = 0x00000007;
+    static constexpr uint32_t CPU_TYPE_X86_64 = 0x01000007;
+    static constexpr uint32_t CPU_TYPE_ARM = 0x0000000C;
+    static constexpr uint32_t CPU_TYPE_ARM64 = 0x0100000C;
+
+    /// Architecture name as used on the command line ("x86_64", "arm64", ...)
+    [[nodiscard]] std::string getArchName() const;
+};
+
+/// Handles the fat header of universal Mach-O binaries
+class UniversalBinary {
+public:
+    /// Returns all slices of a universal binary, or nothing if the data isn't one
+    [[nodiscard]] static std::vector<UniversalSlice> getSlices(std::span<const uint8_t> data);
+};
@@ -0,0 +1,350 @@
+#include "pattern-server.hpp"
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <sstream>
+
+#include "../bindings/pattern-importer.hpp"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+
+static int closeSocket(intptr_t socket) { return closesocket(static_cast<SOCKET>(socket)); }
+static void shutdownSocket(intptr_t socket) { shutdown(static_cast<SOCKET>(socket), SD_BOTH); }
+static void removeSocketFile(const std::string& path) { DeleteFileA(path.c_str()); }
+constexpr int SEND_FLAGS = 0;
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static int closeSocket(intptr_t socket) { return close(static_cast<int>(socket)); }
+static void shutdownSocket(intptr_t socket) { shutdown(static_cast<int>(socket), SHUT_RDWR); }
+static void removeSocketFile(const std::string& path) { unlink(path.c_str()); }
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+#endif
+
+static sockaddr_un makeAddress(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    return address;
+}
+
+/// Unblocks accept() in the listening thread by connecting to it
+static void wakeListener(const std::string& path) {
+    auto address = makeAddress(path);
+    auto socket = static_cast<intptr_t>(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (socket == -1) return;
+    connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    closeSocket(socket);
+}
+
+/// Buffered line reader/writer over a connected socket
+class Connection {
+public:
+    explicit Connection(intptr_t socket) : socket(socket) {}
+
+    std::optional<std::string> readLine() {
+        while (true) {
+            auto newline = buffer.find('\n');
+            if (newline != std::string::npos) {
+                std::string line = buffer.substr(0, newline);
+                buffer.erase(0, newline + 1);
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                return line;
+            }
+
+            char chunk[4096];
+            auto received = recv(socket, chunk, sizeof(chunk), 0);
+            if (received <= 0)
+                return std::nullopt;
+            buffer.append(chunk, static_cast<size_t>(received));
+        }
+    }
+
+    bool write(std::string_view data) {
+        while (!data.empty()) {
+            auto sent = send(socket, data.data(), static_cast<int>(data.size()), SEND_FLAGS);
+            if (sent <= 0)
+                return false;
+            data.remove_prefix(static_cast<size_t>(sent));
+        }
+        return true;
+    }
+
+private:
+    intptr_t socket;
+    std::string buffer;
+};
+
+bool PatternServer::load(const std::string& name, const std::string& binaryPath, int64_t fileOffset, Decompiler::Arch arch, std::string& error) {
+    auto binaryFile = MappedFile::open(binaryPath);
+    if (!binaryFile) {
+        error = "Failed to open binary file: " + binaryPath;
+        return false;
+    }
+
+    auto scanner = std::make_shared<Scanner>(binaryFile, fileOffset);
+    scanner->setAlignment(Decompiler::getInstructionAlignment(arch));
+
+    std::unique_lock lock(scannersMutex);
+    scanners[name] = std::move(scanner);
+    return true;
+}
+
+std::shared_ptr<const Scanner> PatternServer::getScanner(const std::string& name) const {
+    std::shared_lock lock(scannersMutex);
+    auto it = scanners.find(name);
+    if (it == scanners.end()) return nullptr;
+    return it->second;
+}
+
+bool PatternServer::run() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        std::cerr << "Failed to initialize winsock" << std::endl;
+        return false;
+    }
+#endif
+
+    auto address = makeAddress(socketPath);
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << socketPath << std::endl;
+        return false;
+    }
+
+    listener = static_cast<Socket>(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (listener == -1) {
+        std::cerr << "Failed to create socket" << std::endl;
+        return false;
+    }
+
+    // a stale socket file from a previous run would make bind fail
+    removeSocketFile(socketPath);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        std::cerr << "Failed to listen on socket: " << socketPath << std::endl;
+        closeSocket(listener);
+        return false;
+    }
+
+    std::cout << "Listening on " << socketPath << std::endl;
+
+    while (!stopping) {
+        auto client = static_cast<Socket>(accept(listener, nullptr, nullptr));
+        if (client == -1)
+            break;
+
+        if (stopping) {
+            closeSocket(client);
+            break;
+        }
+
+        // a long running server would otherwise keep a thread around for every client it ever had
+        std::erase_if(clientThreads, [](ClientThread& client) {
+            if (!*client.done) return false;
+            client.thread.join();
+            return true;
+        });
+
+        std::lock_guard lock(clientsMutex);
+        clients.insert(client);
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        clientThreads.push_back({std::thread([this, client, done] {
+            handleClient(client);
+            *done = true;
+        }), done});
+    }
+
+    // wake up clients that are still waiting for a request
+    {
+        std::lock_guard lock(clientsMutex);
+        for (auto client : clients)
+            shutdownSocket(client);
+    }
+
+    for (auto& client : clientThreads)
+        client.thread.join();
+    clientThreads.clear();
+
+    closeSocket(listener);
+    removeSocketFile(socketPath);
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    return true;
+}
+
+void PatternServer::handleClient(Socket client) {
+    Connection connection(client);
+
+    auto error = [&](std::string_view message) {
+        return connection.write(std::format("error {}\n", message));
+    };
+
+    while (auto line = connection.readLine()) {
+        try {
+            std::istringstream request(*line);
+            std::string command, name;
+            request >> command >> name;
+
+            if (command == "quit") {
+                break;
+            }
+
+            if (command == "shutdown") {
+                connection.write("ok\n");
+                stopping = true;
+                wakeListener(socketPath);
+                break;
+            }
+
+            if (command == "list") {
+                std::string response;
+                {
+                    std::shared_lock lock(scannersMutex);
+                    for (const auto& [scannerName, scanner] : scanners)
+                        response += std::format("{} {}\n", scannerName, scanner->size());
+                }
+                connection.write(response + "ok\n");
+                continue;
+            }
+
+            if (command == "load") {
+                std::string binaryPath, fileOffset, archName;
+                request >> binaryPath >> fileOffset >> archName;
+                if (name.empty() || binaryPath.empty() || fileOffset.empty()) {
+                    error("usage: load <name> <binary-path> <file-offset> [arch]");
+                    continue;
+                }
+
+                auto arch = archName.empty() ? Decompiler::Arch::x86_64 : Decompiler::parseArch(archName);
+                if (!arch) {
+                    error("unknown architecture");
+                    continue;
+                }
+
+                std::string message;
+                if (!load(name, binaryPath, std::stoll(fileOffset, nullptr, 16), *arch, message)) {
+                    error(message);
+                    continue;
+                }
+                connection.write("ok\n");
+                continue;
+            }
+
+            if (command == "unload") {
+                std::unique_lock lock(scannersMutex);
+                if (scanners.erase(name) == 0) {
+                    lock.unlock();
+                    error("unknown binary");
+                    continue;
+                }
+                lock.unlock();
+                connection.write("ok\n");
+                continue;
+            }
+
+            auto scanner = getScanner(name);
+            if (command == "find") {
+                if (!scanner) {
+                    error("unknown binary");
+                    continue;
+                }
+
+                std::string pattern;
+                std::getline(request >> std::ws, pattern);
+
+                // a pattern without a single fixed bit matches every offset, and the reply would be gigabytes long
+                auto tokens = PatternToken::fromString(pattern);
+                if (std::ranges::all_of(tokens, [](const PatternToken& token) { return token.isWildcard; })) {
+                    error("pattern has no fixed bytes");
+                    continue;
+                }
+
+                std::vector<uintptr_t> results;
+                scanner->find(tokens, results);
+
+                std::string response = "ok";
+                for (auto result : results)
+                    response += std::format(" {:X}", result);
+                connection.write(response + "\n");
+                continue;
+            }
+
+            if (command == "unique") {
+                if (!scanner) {
+                    error("unknown binary");
+                    continue;
+                }
+
+                std::string address, maxLength;
+                request >> address >> maxLength;
+                if (address.empty() || maxLength.empty()) {
+                    error("usage: unique <name> <address> <max-length>");
+                    continue;
+                }
+
+                uintptr_t start = std::stoull(address, nullptr, 16);
+                size_t length = std::stoull(maxLength, nullptr, 10);
+                if (scanner->getMatchBytes(start, length).size() != length) {
+                    error("address out of range");
+                    continue;
+                }
+
+                auto pattern = scanner->generateUniqueMatchPattern(start, length);
+                while (!pattern.empty() && pattern.back() == ' ')
+                    pattern.pop_back();
+                if (pattern.empty()) {
+                    error("no unique pattern");
+                    continue;
+                }
+                connection.write(std::format("ok {}\n", pattern));
+                continue;
+            }
+
+            if (command == "import") {
+                // read the whole batch before answering, so the client can pipeline it
+                std::vector<std::string> lines;
+                while (auto patternLine = connection.readLine()) {
+                    if (patternLine->empty()) break;
+                    lines.push_back(std::move(*patternLine));
+                }
+
+                if (!scanner) {
+                    error("unknown binary");
+                    continue;
+                }
+
+                std::string response;
+                size_t found = 0;
+                for (const auto& patternLine : lines) {
+                    auto result = PatternImporter::importLine(*scanner, patternLine);
+                    if (result.status != ImportResult::Status::Found) continue;
+                    response += std::format("{:X},{},{:X}\n", result.offset, result.name, result.address);
+                    ++found;
+                }
+                connection.write(std::format("{}ok {}/{}\n", response, found, lines.size()));
+                continue;
+            }
+
+            error("unknown command");
+        } catch (const std::exception& e) {
+            // malformed numbers in a request
+            error(e.what());
+        }
+    }
+
+    std::lock_guard lock(clientsMutex);
+    clients.erase(client);
+    closeSocket(client);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../scanner/scanner.hpp"
+#include "../decompiler/decompiler.hpp"
+
+/// Keeps binaries loaded in memory and answers pattern queries over a local (Unix domain) socket,
+/// so repeated runs don't have to read the binary again.
+///
+/// The protocol is line based. Every response ends with a line that is either `ok [...]` or `error <message>`:
+///   load <name> <binary-path> <file-offset> [arch=x64]
+///                                             loads (or replaces) a binary, ARM64 ones are only matched at aligned offsets
+///   unload <name>
+///   list                                      one `<name> <size>` line per binary
+///   find <name> <pattern>                     ok <address> <address> ..., patterns without fixed bytes are rejected
+///   unique <name> <address> <max-length>      ok <pattern>, `address` is a match address like the ones `find` returns
+///   import <name>                             followed by `<offset>,<name>,<pattern>` lines and an empty line,
+///                                             answers with `<offset>,<name>,<new offset>` lines and `ok <found>/<total>`
+///   quit                                      closes the connection
+///   shutdown                                  stops the server
+class PatternServer {
+public:
+    explicit PatternServer(std::string socketPath) : socketPath(std::move(socketPath)) {}
+
+    bool load(const std::string& name, const std::string& binaryPath, int64_t fileOffset, Decompiler::Arch arch, std::string& error);
+
+    /// Accepts clients until a shutdown request, returns false if the socket couldn't be opened
+    bool run();
+
+private:
+    using Socket = intptr_t;
+
+    void handleClient(Socket client);
+
+    [[nodiscard]] std::shared_ptr<const Scanner> getScanner(const std::string& name) const;
+
+    std::string socketPath;
+
+    std::unordered_map<std::string, std::shared_ptr<const Scanner>> scanners;
+    mutable std::shared_mutex scannersMutex;
+
+    /// Thread serving one connection, `done` is set once it only has to be joined
+    struct ClientThread {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+
+    /// Only touched by run(), finished threads are joined whenever a new client connects
+    std::vector<ClientThread> clientThreads;
+    std::unordered_set<Socket> clients;
+    std::mutex clientsMutex;
+
+    Socket listener = -1;
+    std::atomic<bool> stopping = false;
+};
@@ -0,0 +1,74 @@
+#include "memory-stats.hpp"
+#include <format>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+MemoryStats::MemoryStats() {
+#ifdef __linux__
+    // inherited, so threads started later are counted too (their counts are added when they exit).
+    // perf_event_paranoid or a container can forbid this, then TLB misses just aren't reported
+    perf_event_attr attr {};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    tlbCounter = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    start = sample();
+}
+
+MemoryStats::~MemoryStats() {
+#ifdef __linux__
+    if (tlbCounter != -1) close(tlbCounter);
+#endif
+}
+
+MemoryStats::Sample MemoryStats::sample() const {
+    Sample result;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        result.minorFaults = counters.PageFaultCount;
+#else
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        result.minorFaults = usage.ru_minflt;
+        result.majorFaults = usage.ru_majflt;
+    }
+#endif
+
+#ifdef __linux__
+    uint64_t value;
+    if (tlbCounter != -1 && read(tlbCounter, &value, sizeof(value)) == sizeof(value))
+        result.tlbMisses = value;
+#endif
+    return result;
+}
+
+std::string MemoryStats::summary() const {
+    auto now = sample();
+    std::string result = "Page faults: ";
+    if (now.minorFaults && start.minorFaults)
+        result += std::format("{} minor", *now.minorFaults - *start.minorFaults);
+    else
+        result += "unknown";
+    if (now.majorFaults && start.majorFaults)
+        result += std::format(", {} major", *now.majorFaults - *start.majorFaults);
+    if (now.tlbMisses)
+        result += std::format(", dTLB load misses: {}", *now.tlbMisses);
+    return result;
+}
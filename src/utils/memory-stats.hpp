@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/// Page faults and TLB misses of the whole process (all threads) since construction,
+/// to see what the memory layout of the scanned binaries costs.
+/// Counters the platform doesn't provide are left out of the summary.
+class MemoryStats {
+public:
+    MemoryStats();
+    ~MemoryStats();
+
+    MemoryStats(const MemoryStats&) = delete;
+    MemoryStats& operator=(const MemoryStats&) = delete;
+
+    /// e.g. "Page faults: 1234 minor, 5 major, dTLB load misses: 67890"
+    [[nodiscard]] std::string summary() const;
+
+private:
+    struct Sample {
+        std::optional<uint64_t> minorFaults;
+        std::optional<uint64_t> majorFaults;
+        std::optional<uint64_t> tlbMisses;
+    };
+
+    [[nodiscard]] Sample sample() const;
+
+    Sample start;
+    /// perf event counting dTLB load misses (Linux only)
+    int tlbCounter = -1;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) : m_threads(threads) {}
+
+    void addTask(std::function<void()>&& task) {
+        m_tasks.push_back(std::move(task));
+    }
+
+    void runAllTasks() {
+        // create threads
+        for (size_t i = 0; i < m_threads; i++) {
+            m_workers.emplace_back([this]() {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::lock_guard lock(m_tasksMutex);
+                        if (m_tasks.empty())
+                            break;
+
+                        task = std::move(m_tasks.back());
+                        m_tasks.pop_back();
+                    }
+
+                    task();
+                }
+            });
+        }
+
+        // join threads
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+        m_workers.clear();
+    }
+
+private:
+    size_t m_threads;
+    std::vector<std::thread> m_workers;
+    std::vector<std::function<void()>> m_tasks;
+    std::mutex m_tasksMutex;
+};
@@ -0,0 +1,163 @@
+"""
+ctypes bindings for the sigscan library.
+Build it with `-DSIGSCAN_SHARED=ON` and point SIGSCAN_LIBRARY to the resulting library
+(or put it next to this script).
+
+    scanner = Scanner.open('GeometryDash.exe', 0xC00)
+    print(scanner.find('48 89 5C 24 ? 57 48 83 EC 20'))
+"""
+
+import ctypes
+import os
+import sys
+
+ARCH_X86 = 0
+ARCH_X86_64 = 1
+ARCH_ARMV7 = 2
+ARCH_ARMV8 = 3
+
+# SIGSCAN_ERROR from sigscan.h
+ERROR = ctypes.c_size_t(-1).value
+
+
+def _library_path():
+    if 'SIGSCAN_LIBRARY' in os.environ:
+        return os.environ['SIGSCAN_LIBRARY']
+
+    if sys.platform == 'win32':
+        name = 'sigscan.dll'
+    elif sys.platform == 'darwin':
+        name = 'libsigscan.dylib'
+    else:
+        name = 'libsigscan.so'
+
+    return os.path.join(os.path.dirname(os.path.abspath(__file__)), name)
+
+
+_lib = ctypes.CDLL(_library_path())
+
+_u8_p = ctypes.POINTER(ctypes.c_uint8)
+_u64_p = ctypes.POINTER(ctypes.c_uint64)
+_size_p = ctypes.POINTER(ctypes.c_size_t)
+
+_lib.sigscan_scanner_open.argtypes = [ctypes.c_char_p, ctypes.c_int64]
+_lib.sigscan_scanner_open.restype = ctypes.c_void_p
+_lib.sigscan_scanner_from_buffer.argtypes = [_u8_p, ctypes.c_size_t, ctypes.c_int64]
+_lib.sigscan_scanner_from_buffer.restype = ctypes.c_void_p
+_lib.sigscan_scanner_free.argtypes = [ctypes.c_void_p]
+_lib.sigscan_scanner_size.argtypes = [ctypes.c_void_p]
+_lib.sigscan_scanner_size.restype = ctypes.c_size_t
+_lib.sigscan_scanner_set_alignment.argtypes = [ctypes.c_void_p, ctypes.c_size_t]
+
+_lib.sigscan_pattern_compile.argtypes = [ctypes.c_char_p]
+_lib.sigscan_pattern_compile.restype = ctypes.c_void_p
+_lib.sigscan_pattern_free.argtypes = [ctypes.c_void_p]
+
+_lib.sigscan_find.argtypes = [ctypes.c_void_p, ctypes.c_void_p, _u64_p, ctypes.c_size_t]
+_lib.sigscan_find.restype = ctypes.c_size_t
+_lib.sigscan_find_batch.argtypes = [
+    ctypes.c_void_p, ctypes.POINTER(ctypes.c_void_p), ctypes.c_size_t, _u64_p, ctypes.c_size_t, _size_p
+]
+_lib.sigscan_find_batch.restype = ctypes.c_size_t
+_lib.sigscan_generate_signature.argtypes = [
+    ctypes.c_void_p, ctypes.c_int, ctypes.c_uint64, ctypes.c_size_t, ctypes.c_char_p, ctypes.c_size_t
+]
+_lib.sigscan_generate_signature.restype = ctypes.c_size_t
+
+
+class Pattern:
+    def __init__(self, pattern):
+        self._handle = _lib.sigscan_pattern_compile(pattern.encode())
+        if not self._handle:
+            raise ValueError(f'Invalid pattern: {pattern}')
+
+    def __del__(self):
+        if getattr(self, '_handle', None):
+            _lib.sigscan_pattern_free(self._handle)
+
+
+class Scanner:
+    def __init__(self, handle, buffer=None):
+        if not handle:
+            raise OSError('Failed to create scanner')
+        self._handle = handle
+        # keeps zero-copy buffers alive for as long as the scanner
+        self._buffer = buffer
+
+    @staticmethod
+    def open(path, file_offset, alignment=1):
+        scanner = Scanner(_lib.sigscan_scanner_open(path.encode(), file_offset))
+        scanner.set_alignment(alignment)
+        return scanner
+
+    @staticmethod
+    def from_buffer(data, file_offset, alignment=1):
+        """Scans a bytes/bytearray object in place, without copying it.
+
+        A bytearray must not be modified while the scanner exists: the scanner caches an index
+        built from the contents on the first scan, so later writes lead to missed or stale matches.
+        Pass bytes(data) to scan a snapshot instead.
+        """
+        if isinstance(data, bytes):
+            pointer = ctypes.cast(ctypes.c_char_p(data), _u8_p)
+        else:
+            pointer = (ctypes.c_uint8 * len(data)).from_buffer(data)
+        scanner = Scanner(_lib.sigscan_scanner_from_buffer(pointer, len(data), file_offset), (data, pointer))
+        scanner.set_alignment(alignment)
+        return scanner
+
+    def __del__(self):
+        if getattr(self, '_handle', None):
+            _lib.sigscan_scanner_free(self._handle)
+
+    def __len__(self):
+        return _lib.sigscan_scanner_size(self._handle)
+
+    def set_alignment(self, alignment):
+        _lib.sigscan_scanner_set_alignment(self._handle, alignment)
+
+    def find(self, pattern):
+        if isinstance(pattern, str):
+            pattern = Pattern(pattern)
+
+        capacity = 16
+        while True:
+            results = (ctypes.c_uint64 * capacity)()
+            count = _lib.sigscan_find(self._handle, pattern._handle, results, capacity)
+            if count == ERROR:
+                raise RuntimeError('sigscan_find failed')
+            if count <= capacity:
+                return list(results[:count])
+            capacity = count
+
+    def find_batch(self, patterns):
+        patterns = [Pattern(p) if isinstance(p, str) else p for p in patterns]
+        handles = (ctypes.c_void_p * len(patterns))(*[p._handle for p in patterns])
+        counts = (ctypes.c_size_t * len(patterns))()
+
+        capacity = len(patterns) * 2
+        while True:
+            results = (ctypes.c_uint64 * capacity)()
+            total = _lib.sigscan_find_batch(self._handle, handles, len(patterns), results, capacity, counts)
+            if total == ERROR:
+                raise RuntimeError('sigscan_find_batch failed')
+            if total <= capacity:
+                break
+            capacity = total
+
+        found, start = [], 0
+        for count in counts:
+            found.append(list(results[start:start + count]))
+            start += count
+        return found
+
+    def generate_signature(self, arch, address, size):
+        # every call runs the whole search, so only ask again if the signature didn't fit
+        buffer = ctypes.create_string_buffer(4096)
+        length = _lib.sigscan_generate_signature(self._handle, arch, address, size, buffer, len(buffer))
+        if length == 0:
+            return None
+        if length >= len(buffer):
+            buffer = ctypes.create_string_buffer(length + 1)
+            _lib.sigscan_generate_signature(self._handle, arch, address, size, buffer, len(buffer))
+        return buffer.value.decode()